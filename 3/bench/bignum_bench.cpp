@@ -0,0 +1,492 @@
+// Замеры всех операций BigNum на размерах от 1 лимба до 1M лимбов,
+// рядом - то же самое в GMP как ориентир (BM_gmp_*).
+//
+//   cmake -B build -DBIGNUMS_BENCH=ON && cmake --build build --target bignum_bench
+//   ./build/bignum_bench [--benchmark_filter=mul]
+//
+// Кроме таблицы в консоли результаты пишутся в bignum_bench.json
+// (другой файл - --benchmark_out=...). Счётчик ns/limb - наносекунды на лимб
+// операнда, по нему удобно сравнивать размеры между собой.
+
+#include "arena.hpp"
+#include "bignum.hpp"
+#include "fixed.hpp"
+#include "generator.hpp"
+#include "limbs.hpp"
+
+#include <benchmark/benchmark.h>
+#include <gmp.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+#include <vector>
+
+// Счётчик обращений к куче: глобальный operator new заменяется на считающий.
+// noinline - иначе GCC видит free от указателя из operator new и ругается
+static std::atomic<size_t> g_heap_allocs{0};
+
+[[gnu::noinline]] void *operator new(size_t size) {
+    g_heap_allocs.fetch_add(1, std::memory_order_relaxed);
+    if (void *p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+[[gnu::noinline]] void operator delete(void *p) noexcept { std::free(p); }
+[[gnu::noinline]] void operator delete(void *p, size_t) noexcept { std::free(p); }
+
+// Квадратичные операции на миллионе лимбов шли бы часами, поэтому у каждой свой потолок
+static constexpr int64_t MAX_LINEAR_LIMBS    = 1 << 20;
+static constexpr int64_t MAX_QUADRATIC_LIMBS = 1 << 13;
+static constexpr int64_t MAX_ISQRT_LIMBS     = 1 << 11;
+
+static constexpr uint64_t BENCH_SEED = 20240601;
+
+// Случайный операнд ровно из limbs лимбов; stream - чтобы A и B различались
+static BigNum operand(size_t limbs, uint64_t stream) {
+    return generate_bignum(limbs * 32, derive_seed(BENCH_SEED, stream));
+}
+
+struct BenchMpz {
+    mpz_t val;
+    BenchMpz() { mpz_init(val); }
+    explicit BenchMpz(const BigNum &a) {
+        mpz_init(val);
+        mpz_import(val, a.size(), -1, sizeof(uint32_t), 0, 0, a.data());
+    }
+    ~BenchMpz() { mpz_clear(val); }
+    BenchMpz(const BenchMpz&)            = delete;
+    BenchMpz& operator=(const BenchMpz&) = delete;
+};
+
+// ns/limb по часам вокруг цикла замера: создаётся перед циклом, в деструкторе
+// делит прошедшее время на число итераций и лимбов. Там же allocs - сколько
+// раз за одну операцию выделялась память в куче, и scratch_kb - пик занятого
+// в арене временных лимбов (arena.hpp)
+struct PerLimb {
+    using Clock = std::chrono::steady_clock;
+
+    benchmark::State &state;
+    size_t            limbs;
+    Clock::time_point t0     = Clock::now();
+    size_t            allocs = g_heap_allocs.load(std::memory_order_relaxed);
+
+    PerLimb(benchmark::State &s, size_t n) : state(s), limbs(n) { scratch_reset_stats(); }
+
+    ~PerLimb() {
+        double ns = std::chrono::duration<double, std::nano>(Clock::now() - t0).count();
+        double it = static_cast<double>(state.iterations());
+        state.counters["limbs"]   = static_cast<double>(limbs);
+        state.counters["ns/limb"] = it ? ns / it / limbs : 0.0;
+        state.counters["allocs"]  = it ? (g_heap_allocs.load(std::memory_order_relaxed) - allocs) / it : 0.0;
+        state.counters["scratch_kb"] = scratch_stats().peak_bytes / 1024.0;
+    }
+};
+
+// -- Конверсия ---------------------------------------------------------------
+
+static void BM_from_decimal(benchmark::State &state) {
+    size_t      n = state.range(0);
+    std::string s = bignum_to_decimal(operand(n, 0));
+    PerLimb     pl{state, n};
+    for (auto _ : state) benchmark::DoNotOptimize(bignum_from_decimal(s));
+}
+
+static void BM_gmp_from_decimal(benchmark::State &state) {
+    size_t      n = state.range(0);
+    std::string s = bignum_to_decimal(operand(n, 0));
+    BenchMpz    r;
+    PerLimb     pl{state, n};
+    for (auto _ : state) {
+        mpz_set_str(r.val, s.c_str(), 10);
+        benchmark::ClobberMemory();
+    }
+}
+
+static void BM_to_decimal(benchmark::State &state) {
+    size_t  n = state.range(0);
+    BigNum  a = operand(n, 0);
+    PerLimb pl{state, n};
+    for (auto _ : state) benchmark::DoNotOptimize(bignum_to_decimal(a));
+}
+
+static void BM_gmp_to_decimal(benchmark::State &state) {
+    size_t   n = state.range(0);
+    BenchMpz a(operand(n, 0));
+    PerLimb  pl{state, n};
+    for (auto _ : state) {
+        char *s = mpz_get_str(nullptr, 10, a.val);
+        benchmark::DoNotOptimize(s);
+        std::free(s);
+    }
+}
+
+// Длина записи без конвертации; у GMP mpz_sizeinbase может ошибиться на единицу
+// в большую сторону, так что ориентир чуть нечестный в его пользу
+static void BM_decimal_digits(benchmark::State &state) {
+    size_t  n = state.range(0);
+    BigNum  a = operand(n, 0);
+    PerLimb pl{state, n};
+    for (auto _ : state) benchmark::DoNotOptimize(bignum_decimal_digits(a));
+}
+
+static void BM_gmp_decimal_digits(benchmark::State &state) {
+    size_t   n = state.range(0);
+    BenchMpz a(operand(n, 0));
+    PerLimb  pl{state, n};
+    for (auto _ : state) benchmark::DoNotOptimize(mpz_sizeinbase(a.val, 10));
+}
+
+// -- Арифметика ---------------------------------------------------------------
+
+static void BM_add(benchmark::State &state) {
+    size_t  n = state.range(0);
+    BigNum  a = operand(n, 0), b = operand(n, 1);
+    PerLimb pl{state, n};
+    for (auto _ : state) benchmark::DoNotOptimize(bignum_add(a, b));
+}
+
+static void BM_gmp_add(benchmark::State &state) {
+    size_t   n = state.range(0);
+    BenchMpz a(operand(n, 0)), b(operand(n, 1)), r;
+    PerLimb  pl{state, n};
+    for (auto _ : state) {
+        mpz_add(r.val, a.val, b.val);
+        benchmark::ClobberMemory();
+    }
+}
+
+// Уменьшаемое больше вычитаемого: старший лимб a выставлен в единицы
+static void BM_sub(benchmark::State &state) {
+    size_t  n = state.range(0);
+    BigNum  a = operand(n, 0), b = operand(n, 1);
+    a.back()  = 0xFFFFFFFFu;
+    PerLimb pl{state, n};
+    for (auto _ : state) benchmark::DoNotOptimize(bignum_sub(a, b));
+}
+
+static void BM_gmp_sub(benchmark::State &state) {
+    size_t   n = state.range(0);
+    BigNum   ab = operand(n, 0);
+    ab.back()   = 0xFFFFFFFFu;
+    BenchMpz a(ab), b(operand(n, 1)), r;
+    PerLimb  pl{state, n};
+    for (auto _ : state) {
+        mpz_sub(r.val, a.val, b.val);
+        benchmark::ClobberMemory();
+    }
+}
+
+// Сдвиг не на целые лимбы - через limbs_lshift
+static void BM_shl(benchmark::State &state) {
+    size_t  n = state.range(0);
+    BigNum  a = operand(n, 0);
+    PerLimb pl{state, n};
+    for (auto _ : state) benchmark::DoNotOptimize(bignum_shl(a, 77));
+}
+
+static void BM_gmp_shl(benchmark::State &state) {
+    size_t   n = state.range(0);
+    BenchMpz a(operand(n, 0)), r;
+    PerLimb  pl{state, n};
+    for (auto _ : state) {
+        mpz_mul_2exp(r.val, a.val, 77);
+        benchmark::ClobberMemory();
+    }
+}
+
+static void BM_mul(benchmark::State &state) {
+    size_t  n = state.range(0);
+    BigNum  a = operand(n, 0), b = operand(n, 1);
+    PerLimb pl{state, n};
+    for (auto _ : state) benchmark::DoNotOptimize(bignum_mul(a, b));
+}
+
+static void BM_gmp_mul(benchmark::State &state) {
+    size_t   n = state.range(0);
+    BenchMpz a(operand(n, 0)), b(operand(n, 1)), r;
+    PerLimb  pl{state, n};
+    for (auto _ : state) {
+        mpz_mul(r.val, a.val, b.val);
+        benchmark::ClobberMemory();
+    }
+}
+
+// Делимое вдвое длиннее делителя - как у частного от произведения
+static void BM_divmod(benchmark::State &state) {
+    size_t  n = state.range(0);
+    BigNum  a = operand(2 * n, 0), b = operand(n, 1);
+    PerLimb pl{state, n};
+    for (auto _ : state) benchmark::DoNotOptimize(bignum_divmod(a, b));
+}
+
+static void BM_gmp_divmod(benchmark::State &state) {
+    size_t   n = state.range(0);
+    BenchMpz a(operand(2 * n, 0)), b(operand(n, 1)), q, r;
+    PerLimb  pl{state, n};
+    for (auto _ : state) {
+        mpz_tdiv_qr(q.val, r.val, a.val, b.val);
+        benchmark::ClobberMemory();
+    }
+}
+
+static void BM_pow(benchmark::State &state) {
+    size_t  n = state.range(0);
+    BigNum  a = operand(n, 0);
+    PerLimb pl{state, n};
+    for (auto _ : state) benchmark::DoNotOptimize(bignum_pow(a, 3));
+}
+
+static void BM_gmp_pow(benchmark::State &state) {
+    size_t   n = state.range(0);
+    BenchMpz a(operand(n, 0)), r;
+    PerLimb  pl{state, n};
+    for (auto _ : state) {
+        mpz_pow_ui(r.val, a.val, 3);
+        benchmark::ClobberMemory();
+    }
+}
+
+static void BM_isqrt(benchmark::State &state) {
+    size_t  n = state.range(0);
+    BigNum  a = operand(n, 0);
+    PerLimb pl{state, n};
+    for (auto _ : state) benchmark::DoNotOptimize(bignum_isqrt(a));
+}
+
+static void BM_gmp_isqrt(benchmark::State &state) {
+    size_t   n = state.range(0);
+    BenchMpz a(operand(n, 0)), r;
+    PerLimb  pl{state, n};
+    for (auto _ : state) {
+        mpz_sqrt(r.val, a.val);
+        benchmark::ClobberMemory();
+    }
+}
+
+// -- Фиксированная ширина ------------------------------------------------------
+// FixedBigNum напрямую, без перекладывания из BigNum - цена самой операции.
+// BM_mul, BM_divmod на 8 и 64 лимбах уже идут через неё; общий путь на тех же
+// размерах - с переменной окружения BIGNUMS_FIXED=off
+
+template <size_t Bits>
+static void BM_fixed_mul(benchmark::State &state) {
+    auto    a = FixedBigNum<Bits>::from_bignum(operand(Bits / 32, 0));
+    auto    b = FixedBigNum<Bits>::from_bignum(operand(Bits / 32, 1));
+    PerLimb pl{state, Bits / 32};
+    for (auto _ : state) benchmark::DoNotOptimize(fixed_mul(a, b));
+}
+
+template <size_t Bits>
+static void BM_fixed_sqr(benchmark::State &state) {
+    auto    a = FixedBigNum<Bits>::from_bignum(operand(Bits / 32, 0));
+    PerLimb pl{state, Bits / 32};
+    for (auto _ : state) benchmark::DoNotOptimize(fixed_sqr(a));
+}
+
+template <size_t Bits>
+static void BM_fixed_divmod(benchmark::State &state) {
+    auto                   a = FixedBigNum<2 * Bits>::from_bignum(operand(Bits / 16, 0));
+    auto                   b = FixedBigNum<Bits>::from_bignum(operand(Bits / 32, 1));
+    FixedBigNum<2 * Bits>  q;
+    FixedBigNum<Bits>      r;
+    PerLimb                pl{state, Bits / 32};
+    for (auto _ : state) {
+        fixed_divmod(a, b, q, r);
+        benchmark::DoNotOptimize(r);
+    }
+}
+
+// Показатель - 64 бита, модуль - полной ширины: 64 квадрата и деления на итерацию
+template <size_t Bits>
+static void BM_fixed_powmod(benchmark::State &state) {
+    auto    a = FixedBigNum<Bits>::from_bignum(operand(Bits / 32, 0));
+    auto    m = FixedBigNum<Bits>::from_bignum(operand(Bits / 32, 1));
+    auto    e = FixedBigNum<64>::from_bignum(operand(2, 2));
+    PerLimb pl{state, Bits / 32};
+    for (auto _ : state) benchmark::DoNotOptimize(fixed_powmod(a, e, m));
+}
+
+// -- Теория чисел --------------------------------------------------------------
+
+// Перебор делителей до корня - экспонента от длины, поэтому размер тут в битах
+// и только небольшой. Берётся простое число: худший случай, перебор до конца.
+// GMP проверяет вероятностно, это просто ориентир "как надо"
+static BigNum prime_operand(size_t bits) {
+    BenchMpz p(generate_bignum(bits, derive_seed(BENCH_SEED, 2)));
+    mpz_nextprime(p.val, p.val);
+    BigNum r((mpz_sizeinbase(p.val, 2) + 31) / 32, 0);
+    mpz_export(r.data(), nullptr, -1, sizeof(uint32_t), 0, 0, p.val);
+    return r;
+}
+
+static void BM_is_prime(benchmark::State &state) {
+    BigNum  a = prime_operand(state.range(0));
+    PerLimb pl{state, a.size()};
+    for (auto _ : state) benchmark::DoNotOptimize(bignum_is_prime(a));
+}
+
+static void BM_gmp_is_prime(benchmark::State &state) {
+    BigNum   p = prime_operand(state.range(0));
+    BenchMpz a(p);
+    PerLimb  pl{state, p.size()};
+    for (auto _ : state) benchmark::DoNotOptimize(mpz_probab_prime_p(a.val, 25));
+}
+
+static void BM_gcd(benchmark::State &state) {
+    size_t  n = state.range(0);
+    BigNum  a = operand(n, 0), b = operand(n, 1);
+    PerLimb pl{state, n};
+    for (auto _ : state) benchmark::DoNotOptimize(bignum_gcd(a, b));
+}
+
+static void BM_gmp_gcd(benchmark::State &state) {
+    size_t   n = state.range(0);
+    BenchMpz a(operand(n, 0)), b(operand(n, 1)), r;
+    PerLimb  pl{state, n};
+    for (auto _ : state) {
+        mpz_gcd(r.val, a.val, b.val);
+        benchmark::ClobberMemory();
+    }
+}
+
+static void BM_gcdext(benchmark::State &state) {
+    size_t  n = state.range(0);
+    BigNum  a = operand(n, 0), b = operand(n, 1);
+    PerLimb pl{state, n};
+    for (auto _ : state) benchmark::DoNotOptimize(bignum_gcdext(a, b));
+}
+
+static void BM_gmp_gcdext(benchmark::State &state) {
+    size_t   n = state.range(0);
+    BenchMpz a(operand(n, 0)), b(operand(n, 1)), g, x, y;
+    PerLimb  pl{state, n};
+    for (auto _ : state) {
+        mpz_gcdext(g.val, x.val, y.val, a.val, b.val);
+        benchmark::ClobberMemory();
+    }
+}
+
+// -- Исключение девяток --------------------------------------------------------
+
+// Один проход по числу, так что ещё и байты в секунду - сравнить с пропускной способностью памяти
+static void BM_digit_root_mod_9(benchmark::State &state) {
+    size_t  n = state.range(0);
+    BigNum  a = operand(n, 0);
+    PerLimb pl{state, n};
+    for (auto _ : state) benchmark::DoNotOptimize(bignum_digit_root_mod_9(a));
+    state.SetBytesProcessed(state.iterations() * n * sizeof(uint32_t));
+}
+
+// Несколько небольших модулей за проход
+static void BM_mod_small(benchmark::State &state) {
+    size_t                n = state.range(0);
+    BigNum                a = operand(n, 0);
+    std::vector<uint32_t> moduli = {9, 7, 11, 13, 1000003};
+    PerLimb               pl{state, n};
+    for (auto _ : state) benchmark::DoNotOptimize(bignum_mod_small(a, moduli));
+    state.SetBytesProcessed(state.iterations() * n * sizeof(uint32_t));
+}
+
+static void BM_gmp_mod_small(benchmark::State &state) {
+    size_t   n = state.range(0);
+    BenchMpz a(operand(n, 0));
+    PerLimb  pl{state, n};
+    for (auto _ : state)
+        for (unsigned long m : {9ul, 7ul, 11ul, 13ul, 1000003ul})
+            benchmark::DoNotOptimize(mpz_fdiv_ui(a.val, m));
+    state.SetBytesProcessed(state.iterations() * n * sizeof(uint32_t));
+}
+
+static void BM_gmp_digit_root_mod_9(benchmark::State &state) {
+    size_t   n = state.range(0);
+    BenchMpz a(operand(n, 0));
+    PerLimb  pl{state, n};
+    for (auto _ : state) benchmark::DoNotOptimize(mpz_fdiv_ui(a.val, 9));
+}
+
+// Остатки по трём модулям за проход; у GMP - три отдельных mpz_fdiv_ui не получится
+// (модули 64-битные), поэтому ориентир - mpz_tdiv_r на двух и mpz_fdiv_ui на 9
+static void BM_residues(benchmark::State &state) {
+    size_t  n = state.range(0);
+    BigNum  a = operand(n, 0);
+    PerLimb pl{state, n};
+    for (auto _ : state) benchmark::DoNotOptimize(bignum_residues(a));
+}
+
+static void BM_gmp_residues(benchmark::State &state) {
+    size_t   n = state.range(0);
+    BenchMpz a(operand(n, 0)), m61, m64, r;
+    mpz_set_ui(m61.val, 1);
+    mpz_mul_2exp(m61.val, m61.val, 61);
+    mpz_sub_ui(m61.val, m61.val, 1);
+    mpz_set_ui(m64.val, 1);
+    mpz_mul_2exp(m64.val, m64.val, 64);
+    mpz_sub_ui(m64.val, m64.val, 59);
+    PerLimb  pl{state, n};
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(mpz_fdiv_ui(a.val, 9));
+        mpz_tdiv_r(r.val, a.val, m61.val);
+        mpz_tdiv_r(r.val, a.val, m64.val);
+        benchmark::ClobberMemory();
+    }
+}
+
+// Своя реализация и GMP на одних и тех же размерах (1, 8, 64, ... до max лимбов)
+#define BIGNUM_BENCH(name, max_limbs)                                     \
+    BENCHMARK(BM_##name)->RangeMultiplier(8)->Range(1, max_limbs);        \
+    BENCHMARK(BM_gmp_##name)->RangeMultiplier(8)->Range(1, max_limbs)
+
+BIGNUM_BENCH(from_decimal,     MAX_QUADRATIC_LIMBS);
+BIGNUM_BENCH(to_decimal,       MAX_QUADRATIC_LIMBS);
+BIGNUM_BENCH(decimal_digits,   MAX_LINEAR_LIMBS);
+BIGNUM_BENCH(add,              MAX_LINEAR_LIMBS);
+BIGNUM_BENCH(sub,              MAX_LINEAR_LIMBS);
+BIGNUM_BENCH(shl,              MAX_LINEAR_LIMBS);
+BIGNUM_BENCH(mul,              MAX_QUADRATIC_LIMBS);
+BIGNUM_BENCH(divmod,           MAX_QUADRATIC_LIMBS);
+BIGNUM_BENCH(pow,              MAX_QUADRATIC_LIMBS);
+BIGNUM_BENCH(isqrt,            MAX_ISQRT_LIMBS);
+BIGNUM_BENCH(digit_root_mod_9, MAX_LINEAR_LIMBS);
+BIGNUM_BENCH(residues,         MAX_LINEAR_LIMBS);
+BIGNUM_BENCH(mod_small,        MAX_LINEAR_LIMBS);
+BENCHMARK(BM_digit_root_mod_9)->Arg(10'000'000); // порядка 40 МБ - заведомо больше кэша
+BIGNUM_BENCH(gcd,              MAX_QUADRATIC_LIMBS);
+BIGNUM_BENCH(gcdext,           MAX_QUADRATIC_LIMBS);
+BENCHMARK_TEMPLATE(BM_fixed_mul, 256);
+BENCHMARK_TEMPLATE(BM_fixed_mul, 2048);
+BENCHMARK_TEMPLATE(BM_fixed_mul, 8192);
+BENCHMARK_TEMPLATE(BM_fixed_sqr, 256);
+BENCHMARK_TEMPLATE(BM_fixed_sqr, 2048);
+BENCHMARK_TEMPLATE(BM_fixed_sqr, 8192);
+BENCHMARK_TEMPLATE(BM_fixed_divmod, 256);
+BENCHMARK_TEMPLATE(BM_fixed_divmod, 2048);
+BENCHMARK_TEMPLATE(BM_fixed_divmod, 8192);
+BENCHMARK_TEMPLATE(BM_fixed_powmod, 256);
+BENCHMARK_TEMPLATE(BM_fixed_powmod, 2048);
+BENCHMARK(BM_is_prime)->DenseRange(16, 40, 8);
+BENCHMARK(BM_gmp_is_prime)->DenseRange(16, 40, 8);
+
+int main(int argc, char **argv) {
+    // Если файл для результатов не задан, пишем JSON в bignum_bench.json
+    std::vector<char *> args(argv, argv + argc);
+    bool has_out = false;
+    for (char *a : args)
+        if (std::strncmp(a, "--benchmark_out=", 16) == 0) has_out = true;
+    static char out_arg[]    = "--benchmark_out=bignum_bench.json";
+    static char format_arg[] = "--benchmark_out_format=json";
+    if (!has_out) {
+        args.push_back(out_arg);
+        args.push_back(format_arg);
+    }
+
+    int n = static_cast<int>(args.size());
+    benchmark::Initialize(&n, args.data());
+    benchmark::AddCustomContext("kernels", limbs_kernels_name());
+    if (benchmark::ReportUnrecognizedArguments(n, args.data())) return 1;
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
@@ -0,0 +1,578 @@
+// Сверка всех bignum_* с GMP на случайных и неудобных числах.
+//
+// Под clang собирается как цель libFuzzer (входы генерирует и мутирует движок):
+//   CXX=clang++ cmake -B build-fuzz -DBIGNUMS_FUZZ=ON && cmake --build build-fuzz --target bignum_fuzz
+//   ./build-fuzz/bignum_fuzz -max_total_time=600
+// Под другими компиляторами - обычная программа со своим генератором входов:
+//   ./build-fuzz/bignum_fuzz [итераций] [зерно]
+//
+// Из байтов входа строятся два операнда (см. make_operand): кроме случайных
+// лимбов это лимбы из одних единиц, степени двойки, делители с выставленным
+// старшим битом и делимые вида b*q + r, на которых оценка qhat в делении
+// промахивается и срабатывают уточнение и обратное сложение.
+// При расхождении печатаются операнды и процесс падает (abort).
+
+#include "bignum.hpp"
+#include "expr.hpp"
+#include "fixed.hpp"
+
+#include <gmp.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iterator>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Больше - медленнее каждая итерация, а ошибки находятся и на коротких числах
+static constexpr size_t MAX_FUZZ_LIMBS = 48;
+
+struct FuzzMpz {
+    mpz_t val;
+    FuzzMpz() { mpz_init(val); }
+    explicit FuzzMpz(const BigNum &a) {
+        mpz_init(val);
+        mpz_import(val, a.size(), -1, sizeof(uint32_t), 0, 0, a.data());
+    }
+    ~FuzzMpz() { mpz_clear(val); }
+    FuzzMpz(const FuzzMpz&)            = delete;
+    FuzzMpz& operator=(const FuzzMpz&) = delete;
+};
+
+static BigNum from_mpz(const mpz_t z) {
+    BigNum r((mpz_sizeinbase(z, 2) + 31) / 32, 0);
+    size_t count = 0;
+    mpz_export(r.data(), &count, -1, sizeof(uint32_t), 0, 0, z);
+    if (count == 0) return {0};
+    r.resize(count);
+    return r;
+}
+
+static std::string hex(const BigNum &a) {
+    std::string s;
+    char buf[16];
+    for (size_t i = a.size(); i-- > 0; ) {
+        std::snprintf(buf, sizeof buf, "%08x", a[i]);
+        s += buf;
+        if (i) s += '_';
+    }
+    return s;
+}
+
+static const BigNum *g_a = nullptr;
+static const BigNum *g_b = nullptr;
+
+// Расхождение с GMP: печатаем, что и на чём, и падаем, чтобы движок сохранил вход
+static void check(bool ok, const char *what) {
+    if (ok) return;
+    std::fprintf(stderr, "РАСХОЖДЕНИЕ: %s\n  a = %s\n  b = %s\n", what,
+                 g_a ? hex(*g_a).c_str() : "-", g_b ? hex(*g_b).c_str() : "-");
+    std::abort();
+}
+
+// Результат нормализован: старших нулевых лимбов нет, ноль - {0}
+static void check_normalized(const BigNum &r, const char *what) {
+    check(!r.empty() && (r.size() == 1 || r.back() != 0), what);
+}
+
+static void check_equal(const BigNum &r, const mpz_t expected, const char *what) {
+    check_normalized(r, what);
+    check(r == from_mpz(expected), what);
+}
+
+// -----------------------------------------------------------------------
+// Операнды из байтов входа
+// -----------------------------------------------------------------------
+
+struct ByteReader {
+    const uint8_t *data;
+    size_t         size;
+    size_t         pos = 0;
+
+    // За концом входа - нули, чтобы короткие входы тоже давали числа
+    uint8_t byte() { return pos < size ? data[pos++] : 0; }
+    uint32_t u32() {
+        uint32_t v = 0;
+        for (int i = 0; i < 4; ++i) v |= static_cast<uint32_t>(byte()) << (8 * i);
+        return v;
+    }
+};
+
+static void normalize_fuzz(BigNum &a) {
+    while (a.size() > 1 && a.back() == 0) a.pop_back();
+}
+
+static BigNum make_operand(ByteReader &in) {
+    uint8_t kind  = in.byte() % 8;
+    size_t  limbs = 1 + in.byte() % MAX_FUZZ_LIMBS;
+    BigNum  a(limbs, 0);
+    switch (kind) {
+        case 0: // случайные лимбы
+            for (auto &x : a) x = in.u32();
+            break;
+        case 1: // одни единицы: максимум переносов
+            for (auto &x : a) x = 0xFFFFFFFFu;
+            break;
+        case 2: { // степень двойки
+            size_t bit = in.u32() % (limbs * 32);
+            a[bit / 32] = 1u << (bit % 32);
+            break;
+        }
+        case 3: { // 2^k - 1
+            size_t bits = 1 + in.u32() % (limbs * 32);
+            for (size_t i = 0; i < bits; ++i) a[i / 32] |= 1u << (i % 32);
+            break;
+        }
+        case 4: // старший бит выставлен: делитель без нормализующего сдвига
+            for (auto &x : a) x = in.u32();
+            a.back() |= 0x80000000u;
+            break;
+        case 5: // почти все лимбы нулевые
+            for (auto &x : a) if (in.byte() % 4 == 0) x = in.u32();
+            break;
+        case 6: // одно короткое число
+            a.assign(1, in.u32() >> (in.byte() % 32));
+            break;
+        default: { // лимбы из "граничных" значений
+            static const uint32_t EDGE[] = {0, 1, 0x7FFFFFFFu, 0x80000000u, 0xFFFFFFFEu, 0xFFFFFFFFu};
+            for (auto &x : a) {
+                uint8_t pick = in.byte();
+                x = pick < 6 * 40 ? EDGE[pick % 6] : in.u32();
+            }
+            break;
+        }
+    }
+    normalize_fuzz(a);
+    return a;
+}
+
+// -----------------------------------------------------------------------
+// Проверки
+// -----------------------------------------------------------------------
+
+static void check_conversion(const BigNum &a, ByteReader &in) {
+    FuzzMpz za(a);
+    char *c = mpz_get_str(nullptr, 10, za.val);
+    std::string expected(c);
+    std::free(c);
+
+    std::string s = bignum_to_decimal(a);
+    check(s == expected, "bignum_to_decimal");
+
+    std::string streamed;
+    bignum_write_decimal(a, [&](std::string_view chunk) { streamed.append(chunk); });
+    check(streamed == expected, "bignum_write_decimal");
+
+    check(bignum_from_decimal(s) == a, "bignum_from_decimal");
+    BigNum parsed;
+    check(bignum_parse_decimal(s, parsed) && parsed == a, "bignum_parse_decimal");
+    check(bignum_is_valid_decimal(s), "bignum_is_valid_decimal");
+
+    size_t len = expected.size();
+    check(bignum_decimal_digits(a) == len, "bignum_decimal_digits");
+    // Вплотную к степени десяти приближённого сравнения не хватает: 10^m - 1, 10^m, 10^m + 1
+    {
+        size_t  m = 1 + in.byte() % (len + 40);
+        FuzzMpz p;
+        mpz_ui_pow_ui(p.val, 10, m);
+        for (int d = -1; d <= 1; ++d) {
+            FuzzMpz x;
+            if (d < 0) mpz_sub_ui(x.val, p.val, 1);
+            else       mpz_add_ui(x.val, p.val, static_cast<unsigned long>(d));
+            check(bignum_decimal_digits(from_mpz(x.val)) == m + (d >= 0), "bignum_decimal_digits (10^m)");
+        }
+    }
+
+    size_t k = 1 + in.byte() % (len + 2);
+    check(bignum_leading_digits(a, k) == expected.substr(0, k), "bignum_leading_digits");
+    std::string tail = k >= len ? expected : expected.substr(len - k);
+    check(bignum_trailing_digits(a, k) == tail, "bignum_trailing_digits");
+    size_t from  = in.byte() % len;
+    size_t count = 1 + in.byte() % (len - from);
+    check(bignum_decimal_slice(a, from, count) == expected.substr(from, count), "bignum_decimal_slice");
+
+    // Правка записи: кусок [pos, pos + cut) заменяется на ins случайных цифр
+    size_t pos = in.byte() % (len + 1);
+    size_t cut = in.byte() % (len - pos + 1);
+    size_t ins = in.byte() % 12;
+    std::string edited = expected.substr(0, pos);
+    for (size_t i = 0; i < ins; ++i) edited += static_cast<char>('0' + in.byte() % 10);
+    edited += expected.substr(pos + cut);
+    size_t nz = edited.find_first_not_of('0');
+    edited.erase(0, nz == std::string::npos ? (edited.empty() ? 0 : edited.size() - 1) : nz);
+    if (!edited.empty()) {
+        BigNum value = a;
+        if (bignum_update_decimal(value, expected, edited)) {
+            FuzzMpz ze;
+            mpz_set_str(ze.val, edited.c_str(), 10);
+            check_equal(value, ze.val, "bignum_update_decimal");
+        } else {
+            check(value == a, "bignum_update_decimal (отказ не должен трогать число)");
+        }
+    }
+}
+
+static void check_arithmetic(const BigNum &a, const BigNum &b) {
+    FuzzMpz za(a), zb(b), r, q;
+
+    check(bignum_is_zero(a) == (mpz_sgn(za.val) == 0), "bignum_is_zero");
+    int c = mpz_cmp(za.val, zb.val);
+    check(bignum_cmp(a, b) == (c < 0 ? -1 : c > 0 ? 1 : 0), "bignum_cmp");
+
+    mpz_add(r.val, za.val, zb.val);
+    check_equal(bignum_add(a, b), r.val, "bignum_add");
+
+    if (c >= 0) {
+        mpz_sub(r.val, za.val, zb.val);
+        check_equal(bignum_sub(a, b), r.val, "bignum_sub");
+    }
+
+    mpz_mul(r.val, za.val, zb.val);
+    check_equal(bignum_mul(a, b), r.val, "bignum_mul");
+
+    mpz_mul(r.val, za.val, za.val);
+    check_equal(bignum_sqr(a), r.val, "bignum_sqr");
+
+    if (mpz_sgn(zb.val) != 0) {
+        mpz_tdiv_qr(q.val, r.val, za.val, zb.val);
+        auto [bq, br] = bignum_divmod(a, b);
+        check_equal(bq, q.val, "bignum_divmod (частное)");
+        check_equal(br, r.val, "bignum_divmod (остаток)");
+    }
+
+    if (a.size() <= MAX_FUZZ_LIMBS / 3) {
+        for (int e = 1; e <= 3; ++e) {
+            mpz_pow_ui(r.val, za.val, e);
+            check_equal(bignum_pow(a, e), r.val, "bignum_pow");
+        }
+    }
+
+    // Возведения в степень по модулю в BigNum нет, сверяем fixed_powmod напрямую:
+    // здесь на неудобных операндах в 256 бит, все ширины - в check_fixed_widths.
+    // Модуль - b полной ширины 256 бит (старшее слово не пустое)
+    if (b.size() >= 7 && b.size() <= 8 && a.size() <= 8) {
+        auto fa = FixedBigNum<256>::from_bignum(a);
+        auto fb = FixedBigNum<256>::from_bignum(b);
+        mpz_powm(r.val, za.val, za.val, zb.val);
+        check_equal(fixed_powmod(fa, fa, fb).to_bignum(), r.val, "fixed_powmod");
+    }
+
+    mpz_gcd(r.val, za.val, zb.val);
+    check_equal(bignum_gcd(a, b), r.val, "bignum_gcd");
+
+    // Коэффициенты Безу не единственны, поэтому проверяется само равенство a*x + b*y = g
+    BigNumGcdExt e = bignum_gcdext(a, b);
+    check_equal(e.g, r.val, "bignum_gcdext (НОД)");
+    {
+        FuzzMpz x(e.x.mag), y(e.y.mag);
+        if (e.x.neg) mpz_neg(x.val, x.val);
+        if (e.y.neg) mpz_neg(y.val, y.val);
+        mpz_mul(x.val, x.val, za.val);
+        mpz_addmul(x.val, y.val, zb.val);
+        check(mpz_cmp(x.val, r.val) == 0, "bignum_gcdext (a*x + b*y != g)");
+    }
+
+    if (mpz_sgn(zb.val) != 0 && mpz_cmp_ui(zb.val, 1) != 0) {
+        bool invertible = mpz_invert(q.val, za.val, zb.val) != 0;
+        try {
+            BigNum inv = bignum_modinv(a, b);
+            check(invertible, "bignum_modinv (обратного нет, а он посчитан)");
+            check_equal(inv, q.val, "bignum_modinv");
+        } catch (const std::invalid_argument &) {
+            check(!invertible, "bignum_modinv (обратный есть, а брошено исключение)");
+        }
+    }
+
+    mpz_sqrt(r.val, za.val);
+    check_equal(bignum_isqrt(a), r.val, "bignum_isqrt");
+
+    int r9 = static_cast<int>(mpz_fdiv_ui(za.val, 9));
+    check(bignum_digit_root_mod_9(a) == r9, "bignum_digit_root_mod_9");
+
+    {
+        std::vector<uint32_t> moduli = {9, 2, 3, 7, 1000003, MOD_SMALL_MAX, MOD_SMALL_MAX - 1};
+        std::vector<uint32_t> got    = bignum_mod_small(a, moduli);
+        for (size_t i = 0; i < moduli.size(); ++i)
+            check(got[i] == mpz_fdiv_ui(za.val, moduli[i]), "bignum_mod_small");
+    }
+
+    BigNumResidues res = bignum_residues(a);
+    check(res.m9 == mpz_fdiv_ui(za.val, 9), "bignum_residues (mod 9)");
+    {
+        FuzzMpz m;
+        mpz_set_ui(m.val, 1);
+        mpz_mul_2exp(m.val, m.val, 61);
+        mpz_sub_ui(m.val, m.val, 1);
+        mpz_mod(r.val, za.val, m.val);
+        check(res.m61 == mpz_get_ui(r.val), "bignum_residues (mod 2^61-1)");
+        mpz_set_ui(m.val, 1);
+        mpz_mul_2exp(m.val, m.val, 64);
+        mpz_sub_ui(m.val, m.val, 59);
+        mpz_mod(r.val, za.val, m.val);
+        check(res.m64 == mpz_get_ui(r.val), "bignum_residues (mod 2^64-59)");
+    }
+
+    // Перебор делителей долгий, проверяем только небольшие числа
+    if (a.size() == 1 && a[0] < (1u << 24))
+        check(bignum_is_prime(a) == (mpz_probab_prime_p(za.val, 50) != 0), "bignum_is_prime");
+}
+
+static void check_bits(const BigNum &a, const BigNum &b, ByteReader &in) {
+    FuzzMpz za(a), zb(b), r;
+
+    check(bignum_bit_length(a) == (mpz_sgn(za.val) ? mpz_sizeinbase(za.val, 2) : 0), "bignum_bit_length");
+    check(bignum_popcount(a) == mpz_popcount(za.val), "bignum_popcount");
+    check(bignum_ctz(a) == (mpz_sgn(za.val) ? mpz_scan1(za.val, 0) : 0), "bignum_ctz");
+
+    // Сдвиги на 0..31 бит и на целые лимбы, в том числе за длину числа
+    size_t bits = in.byte() % 2 ? in.byte() % 32 : in.u32() % (a.size() * 32 + 64);
+    mpz_mul_2exp(r.val, za.val, bits);
+    check_equal(bignum_shl(a, bits), r.val, "bignum_shl");
+    mpz_fdiv_q_2exp(r.val, za.val, bits);
+    check_equal(bignum_shr(a, bits), r.val, "bignum_shr");
+
+    mpz_and(r.val, za.val, zb.val);
+    check_equal(bignum_and(a, b), r.val, "bignum_and");
+    mpz_ior(r.val, za.val, zb.val);
+    check_equal(bignum_or(a, b), r.val, "bignum_or");
+    mpz_xor(r.val, za.val, zb.val);
+    check_equal(bignum_xor(a, b), r.val, "bignum_xor");
+}
+
+// Числа со знаком: знаки берутся из входа, сверяются знак и модуль
+static void check_signed(const BigNum &a, const BigNum &b, ByteReader &in) {
+    uint8_t      signs = in.byte();
+    SignedBigNum sa    = sbignum_make(a, signs & 1);
+    SignedBigNum sb    = sbignum_make(b, signs & 2);
+    FuzzMpz za(a), zb(b), r, q;
+    if (sa.neg) mpz_neg(za.val, za.val);
+    if (sb.neg) mpz_neg(zb.val, zb.val);
+
+    auto check_signed_equal = [](const SignedBigNum &x, const mpz_t expected, const char *what) {
+        check(x.neg == (mpz_sgn(expected) < 0), what);
+        FuzzMpz mag;
+        mpz_abs(mag.val, expected);
+        check_equal(x.mag, mag.val, what);
+    };
+
+    int c = mpz_cmp(za.val, zb.val);
+    check(sbignum_cmp(sa, sb) == (c < 0 ? -1 : c > 0 ? 1 : 0), "sbignum_cmp");
+
+    mpz_add(r.val, za.val, zb.val);
+    check_signed_equal(sbignum_add(sa, sb), r.val, "sbignum_add");
+    mpz_sub(r.val, za.val, zb.val);
+    check_signed_equal(sbignum_sub(sa, sb), r.val, "sbignum_sub");
+    mpz_mul(r.val, za.val, zb.val);
+    check_signed_equal(sbignum_mul(sa, sb), r.val, "sbignum_mul");
+    mpz_neg(r.val, za.val);
+    check_signed_equal(sbignum_neg(sa), r.val, "sbignum_neg");
+
+    if (mpz_sgn(zb.val) != 0) {
+        mpz_tdiv_qr(q.val, r.val, za.val, zb.val);
+        auto [sq, sr] = sbignum_divmod(sa, sb);
+        check_signed_equal(sq, q.val, "sbignum_divmod (частное)");
+        check_signed_equal(sr, r.val, "sbignum_divmod (остаток)");
+    }
+
+    check(sbignum_from_decimal(sbignum_to_decimal(sa)) == sa, "sbignum_from_decimal");
+}
+
+// -- Фиксированная ширина -----------------------------------------------------
+// MAX_FUZZ_LIMBS мал для широких FixedBigNum, поэтому для них операнды строятся
+// отдельно: длина - ровно та, при которой bignum_mul/sqr/divmod переходят на
+// ширину W (см. fixed_try_* в fixed.cpp), лимбы - из зерна входа
+
+// limbs лимбов, старший не нулевой: случайные, одни единицы или граничные значения
+static BigNum fixed_operand(ByteReader &in, size_t limbs) {
+    std::mt19937_64 rng(in.u32());
+    uint8_t         kind = in.byte() % 4;
+    BigNum          a(limbs);
+    for (auto &x : a) {
+        static const uint32_t EDGE[] = {0, 1, 0x7FFFFFFFu, 0x80000000u, 0xFFFFFFFEu, 0xFFFFFFFFu};
+        uint32_t r = static_cast<uint32_t>(rng());
+        x = kind == 1 ? 0xFFFFFFFFu : kind == 2 ? EDGE[r % 6] : r;
+    }
+    if (a.back() == 0) a.back() = 1;
+    return a;
+}
+
+template <size_t W>
+static void check_fixed_powmod(const BigNum &a, const BigNum &m, uint32_t exp) {
+    FuzzMpz za(a), zm(m), r;
+    mpz_powm_ui(r.val, za.val, exp, zm.val);
+    auto e = FixedBigNum<64>::from_bignum(BigNum{exp});
+    check_equal(fixed_powmod(FixedBigNum<W>::from_bignum(a), e, FixedBigNum<W>::from_bignum(m)).to_bignum(),
+                r.val, "fixed_powmod");
+}
+
+static void check_fixed_widths(ByteReader &in) {
+    if (in.byte() % 4 != 0) return; // широкие числа медленные - на четверти входов
+    size_t w    = FIXED_WIDTHS[in.byte() % std::size(FIXED_WIDTHS)];
+    size_t full = w / 32, half = w / 64;
+
+    // Умножение и квадрат: оба множителя больше W/2 и до W бит
+    BigNum a = fixed_operand(in, half + 1 + in.byte() % half);
+    BigNum b = fixed_operand(in, half + 1 + in.byte() % half);
+    // Деление: делитель ровно W бит, делимое больше 1.5W и до 2W; иногда b*q + r
+    // с q из единиц, где оценка qhat чаще всего завышена
+    BigNum d = fixed_operand(in, full);
+    BigNum n = fixed_operand(in, 3 * half + 1 + in.byte() % half);
+    if (in.byte() % 2) {
+        FuzzMpz zd(d), zq(BigNum(half + 1, 0xFFFFFFFFu)), zr(fixed_operand(in, full)), zn;
+        mpz_tdiv_r(zr.val, zr.val, zd.val);
+        mpz_mul(zn.val, zd.val, zq.val);
+        mpz_add(zn.val, zn.val, zr.val);
+        n = from_mpz(zn.val);
+    }
+    g_a = &a;
+    g_b = &b;
+
+    FuzzMpz za(a), zb(b), zd(d), zn(n), r, q;
+    BigNum  fr, fq;
+    bool    on = bignum_fixed_enabled();
+    mpz_mul(r.val, za.val, zb.val);
+    check(fixed_try_mul(a, b, fr) == on, "fixed_try_mul (ширина не выбрана)");
+    if (on) check_equal(fr, r.val, "fixed_try_mul");
+    check_equal(bignum_mul(a, b), r.val, "bignum_mul (фиксированная ширина)");
+
+    mpz_mul(r.val, za.val, za.val);
+    check(fixed_try_sqr(a, fr) == on, "fixed_try_sqr (ширина не выбрана)");
+    if (on) check_equal(fr, r.val, "fixed_try_sqr");
+    check_equal(bignum_sqr(a), r.val, "bignum_sqr (фиксированная ширина)");
+
+    g_a = &n;
+    g_b = &d;
+    mpz_tdiv_qr(q.val, r.val, zn.val, zd.val);
+    if (n.size() > 3 * half) { // b*q + r мог выйти короче 1.5W - тогда переход не обязателен
+        check(fixed_try_divmod(n, d, fq, fr) == on, "fixed_try_divmod (ширина не выбрана)");
+        if (on) {
+            check_equal(fq, q.val, "fixed_try_divmod (частное)");
+            check_equal(fr, r.val, "fixed_try_divmod (остаток)");
+        }
+    }
+    auto [bq, br] = bignum_divmod(n, d);
+    check_equal(bq, q.val, "bignum_divmod (фиксированная ширина, частное)");
+    check_equal(br, r.val, "bignum_divmod (фиксированная ширина, остаток)");
+
+    // Основание - a (до W бит), модуль - d полной ширины
+    g_a = &a;
+    uint32_t exp = in.u32() >> (in.byte() % 32);
+    switch (w) {
+        case 256:  check_fixed_powmod<256>(a, d, exp);  break;
+        case 512:  check_fixed_powmod<512>(a, d, exp);  break;
+        case 1024: check_fixed_powmod<1024>(a, d, exp); break;
+        case 2048: check_fixed_powmod<2048>(a, d, exp); break;
+        case 4096: check_fixed_powmod<4096>(a, d, exp); break;
+        case 8192: check_fixed_powmod<8192>(a, d, exp); break;
+        default:   check(false, "FIXED_WIDTHS без проверки в check_fixed_widths");
+    }
+}
+
+// Выражения: значение против прямых вызовов bignum_*, слияние одинаковых узлов,
+// x*x как квадрат и кэш узлов по версиям чисел
+static void check_expr(const BigNum &a, const BigNum &b) {
+    // A*B и B*A - один узел; A*A и A^2 - один квадрат (иначе узлов было бы 4)
+    check(ExprGraph("A*B + B*a").node_count() == 4, "ExprGraph (A*B и B*A не слились)");
+    check(ExprGraph("A*A + A^2").node_count() == 3, "ExprGraph (A*A не стало квадратом)");
+
+    ExprGraph::Stats st;
+    ExprGraph        g1("(A + 7)*(A + 7) - B % 10 + A / 3");
+    BigNum           a7 = bignum_add(a, BigNum{7});
+    BigNum           e1 = bignum_add(bignum_sub(bignum_sqr(a7), bignum_divmod(b, BigNum{10}).second),
+                                     bignum_divmod(a, BigNum{3}).first);
+    check(g1.evaluate(a, 1, b, 1) == e1, "ExprGraph::evaluate");
+
+    // Узлы: A*B, A^2, A^3, сумма, остаток. После смены B пересчитываются
+    // только три зависящих от B, квадрат и куб берутся из кэша
+    if (bignum_is_zero(b)) return;
+    ExprGraph g2("(A*B + A^3) mod B");
+    auto expected = [&a](const BigNum &y) {
+        return bignum_divmod(bignum_add(bignum_mul(a, y), bignum_pow(a, 3)), y).second;
+    };
+    check(g2.evaluate(a, 1, b, 1, &st) == expected(b) && st.computed == 5 && st.reused == 0,
+          "ExprGraph::evaluate (первый расчёт)");
+    check(g2.evaluate(a, 1, b, 1, &st) == expected(b) && st.computed == 0 && st.reused == 5,
+          "ExprGraph::evaluate (те же версии)");
+    BigNum b2 = bignum_add(b, BigNum{1});
+    check(g2.evaluate(a, 1, b2, 2, &st) == expected(b2) && st.computed == 3 && st.reused == 2,
+          "ExprGraph::evaluate (новая версия B)");
+}
+
+static void check_input(const uint8_t *data, size_t size) {
+    ByteReader in{data, size};
+    BigNum a = make_operand(in);
+    BigNum b = make_operand(in);
+
+    // Делимое вида b*q + r: с q из единиц или граничных лимбов оценка qhat
+    // чаще всего оказывается завышенной
+    if (in.byte() % 2 && !bignum_is_zero(b)) {
+        BigNum  q = make_operand(in);
+        FuzzMpz zb(b), zq(q), zr(make_operand(in)), za;
+        mpz_tdiv_r(zr.val, zr.val, zb.val);
+        mpz_mul(za.val, zb.val, zq.val);
+        mpz_add(za.val, za.val, zr.val);
+        a = from_mpz(za.val);
+    }
+
+    g_a = &a;
+    g_b = &b;
+    check_conversion(a, in);
+    check_arithmetic(a, b);
+    check_arithmetic(b, a);
+    check_bits(a, b, in);
+    check_signed(a, b, in);
+    check_expr(a, b);
+    check_fixed_widths(in);
+    g_a = g_b = nullptr;
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    check_input(data, size);
+    return 0;
+}
+
+#ifndef BIGNUMS_LIBFUZZER
+
+// Заготовленные трудные деления в духе тестов divmnu из Hacker's Delight:
+// старшие лимбы подобраны так, что первая оценка qhat завышена, вычитание
+// уходит в минус и нужно обратное сложение
+static const std::vector<std::pair<BigNum, BigNum>> DIVMOD_CASES = {
+    {{0x00000000, 0x00000000, 0x80000000, 0x7FFFFFFF}, {0x00000001, 0x00000000, 0x80000000}},
+    {{0x00000003, 0x00000000, 0x80000000},             {0x00000001, 0x00000000, 0x20000000}},
+    {{0x00000003, 0x00000000, 0x00008000},             {0x00000001, 0x00000000, 0x00002000}},
+    {{0x00000000, 0x0000FFFE, 0x00008000},             {0x0000FFFF, 0x00008000}},
+    {{0x00000000, 0xFFFE0000, 0x00008000},             {0xFFFF0000, 0x00008000}},
+    {{0x89ABCDEF, 0x01234567, 0x00000000, 0x80000000}, {0x00000001, 0x00000000, 0x80000000}},
+    {{0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF, 0x7FFFFFFF}, {0xFFFFFFFF, 0x80000000}},
+    // Старший лимб окна равен старшему лимбу делителя (u[j+n] == vn1): qhat = 2^32-1,
+    // и остаток rhat = u[j+n-1] + vn1 уже не влезает в 32 бита - уточнять нельзя.
+    // С приближённым rhat qhat уменьшался, и частное выходило на единицу меньше
+    {{0xEAE5722C, 0x67AEE2E5, 0x80000001},             {0x78E51061, 0x80000001}},
+};
+
+// Без libFuzzer: сначала известные трудные случаи, затем случайные входы
+int main(int argc, char **argv) {
+    unsigned long iterations = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 100000;
+    uint64_t      seed       = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : std::random_device{}();
+
+    for (const auto &[a, b] : DIVMOD_CASES) {
+        g_a = &a;
+        g_b = &b;
+        check_arithmetic(a, b);
+    }
+
+    std::mt19937_64 rng(seed);
+    std::vector<uint8_t> buf;
+    for (unsigned long i = 0; i < iterations; ++i) {
+        buf.resize(rng() % 1024);
+        for (auto &x : buf) x = static_cast<uint8_t>(rng());
+        check_input(buf.data(), buf.size());
+    }
+    std::printf("OK: %lu входов, зерно %llu\n", iterations, static_cast<unsigned long long>(seed));
+    return 0;
+}
+
+#endif
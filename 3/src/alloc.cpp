@@ -0,0 +1,58 @@
+#include "alloc.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <sys/mman.h>
+
+// ----------------------------------------------------------------------------
+// Отображение берётся с запасом в одну большую страницу, из него вырезается
+// кусок с границы 2 МБ (иначе ядро не сможет подложить под него большие
+// страницы), лишнее по краям сразу возвращается. Длина тоже округляется до 2 МБ,
+// так что при освобождении её можно посчитать по одному размеру буфера
+// ----------------------------------------------------------------------------
+
+static constexpr size_t HUGE_PAGE_BYTES = 2u << 20;
+
+static size_t round_huge(size_t bytes) {
+    return (bytes + HUGE_PAGE_BYTES - 1) & ~(HUGE_PAGE_BYTES - 1);
+}
+
+static std::atomic<bool> &huge_pages_flag() {
+    static std::atomic<bool> flag{[] {
+        const char *env = std::getenv("BIGNUMS_HUGEPAGES");
+        return env && (std::strcmp(env, "1") == 0 || std::strcmp(env, "on") == 0);
+    }()};
+    return flag;
+}
+
+void bignum_set_huge_pages(bool on) { huge_pages_flag().store(on, std::memory_order_relaxed); }
+
+bool bignum_huge_pages() { return huge_pages_flag().load(std::memory_order_relaxed); }
+
+void *big_alloc(size_t bytes) {
+    size_t len = round_huge(bytes);
+    void  *raw = ::mmap(nullptr, len + HUGE_PAGE_BYTES, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (raw == MAP_FAILED) throw std::bad_alloc();
+
+    uintptr_t start   = reinterpret_cast<uintptr_t>(raw);
+    uintptr_t aligned = (start + HUGE_PAGE_BYTES - 1) & ~(HUGE_PAGE_BYTES - 1);
+    if (aligned > start)
+        ::munmap(raw, aligned - start);
+    if (size_t tail = start + HUGE_PAGE_BYTES - aligned; tail > 0)
+        ::munmap(reinterpret_cast<void *>(aligned + len), tail);
+
+#ifdef MADV_HUGEPAGE
+    // Не получилось (ядро без THP) - просто останутся обычные страницы
+    if (bignum_huge_pages())
+        ::madvise(reinterpret_cast<void *>(aligned), len, MADV_HUGEPAGE);
+#endif
+    return reinterpret_cast<void *>(aligned);
+}
+
+void big_free(void *p, size_t bytes) noexcept {
+    ::munmap(p, round_huge(bytes));
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include "profile.hpp"
+
+#include <cstddef>
+#include <memory>
+
+// Память под лимбы больших чисел (см. BigNum в bignum.hpp).
+// Буферы от BIG_ALLOC_MIN_BYTES берутся у системы отдельным mmap с границы 2 МБ:
+// - с включёнными большими страницами (bignum_set_huge_pages или переменная
+//   окружения BIGNUMS_HUGEPAGES=1) на них ставится madvise(MADV_HUGEPAGE), и
+//   число из десятков мегабайт занимает десятки записей TLB, а не тысячи;
+// - страницы свежие и не тронуты, поэтому ядро кладёт их на узел NUMA того
+//   потока, который первым в них пишет (first touch). Число, посчитанное в
+//   рабочем потоке (expr, пакетный режим), оказывается в памяти его узла, а не
+//   в куче, которую до этого трогал другой поток.
+// Всё, что меньше, - обычный operator new. Выделения учитываются профилировщиком (profile.hpp)
+
+inline constexpr size_t BIG_ALLOC_MIN_BYTES = 4u << 20;
+
+void *big_alloc(size_t bytes);
+void  big_free(void *p, size_t bytes) noexcept;
+
+// Большие страницы для новых буферов; уже выделенные не меняются
+void bignum_set_huge_pages(bool on);
+bool bignum_huge_pages();
+
+template <class T>
+struct LimbAllocator {
+    using value_type = T;
+
+    LimbAllocator() = default;
+    template <class U> LimbAllocator(const LimbAllocator<U> &) noexcept {}
+
+    T *allocate(size_t n) {
+        prof_note_alloc(n * sizeof(T));
+        if (n * sizeof(T) >= BIG_ALLOC_MIN_BYTES) return static_cast<T *>(big_alloc(n * sizeof(T)));
+        return std::allocator<T>().allocate(n);
+    }
+
+    void deallocate(T *p, size_t n) noexcept {
+        if (n * sizeof(T) >= BIG_ALLOC_MIN_BYTES) big_free(p, n * sizeof(T));
+        else                                      std::allocator<T>().deallocate(p, n);
+    }
+
+    bool operator==(const LimbAllocator &) const = default;
+};
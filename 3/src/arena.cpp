@@ -0,0 +1,106 @@
+#include "arena.hpp"
+
+#include "alloc.hpp"
+
+#include <algorithm>
+#include <vector>
+
+// ----------------------------------------------------------------------------
+// Арена - список кусков. Вершина - номер текущего куска и занятое в нём. Если
+// выделение не влезает в остаток, переходим в следующий кусок (или заводим новый,
+// не меньше всех прежних вместе - так число обращений к системе логарифмическое).
+// Хвост предыдущего куска при этом пропадает до отката кадра, зато адреса
+// выданных указателей никогда не меняются
+// ----------------------------------------------------------------------------
+
+namespace {
+
+// Меньше куска не заводим, чтобы мелкие деления не дёргали систему по одному разу
+constexpr size_t SCRATCH_MIN_LIMBS = 4096;
+// Сколько памяти арена держит между операциями; больше - отдаём, когда все кадры закрыты
+constexpr size_t SCRATCH_KEEP_LIMBS = (16u << 20) / sizeof(uint32_t);
+
+// Куски - через тот же аллокатор, что и у BigNum: большие встают на большие страницы
+struct Chunk {
+    uint32_t *data;
+    size_t    size;
+};
+
+Chunk new_chunk(size_t size) { return {LimbAllocator<uint32_t>().allocate(size), size}; }
+
+struct Arena {
+    std::vector<Chunk> chunks;
+    size_t chunk    = 0; // текущий кусок
+    size_t top      = 0; // занято в текущем куске
+    size_t in_use   = 0; // занято всего (для пика)
+    size_t capacity = 0;
+    size_t depth    = 0; // открытых кадров
+    ScratchStats stats;
+
+    // Делает так, чтобы в текущем куске было свободно хотя бы limbs
+    void ensure(size_t limbs) {
+        if (!chunks.empty() && chunks[chunk].size - top >= limbs) return;
+        if (chunks.empty() || depth == 0) {
+            // Ничего не занято: вместо цепочки кусков - один общий
+            size_t size = std::max({limbs, capacity, SCRATCH_MIN_LIMBS});
+            release();
+            chunks.push_back(new_chunk(size));
+            capacity = size;
+            chunk = top = 0;
+            ++stats.system_allocs;
+            return;
+        }
+        size_t next = chunk + 1;
+        if (next == chunks.size() || chunks[next].size < limbs) {
+            size_t size = std::max({limbs, capacity, SCRATCH_MIN_LIMBS});
+            chunks.insert(chunks.begin() + static_cast<std::ptrdiff_t>(next), new_chunk(size));
+            capacity += size;
+            ++stats.system_allocs;
+        }
+        chunk = next;
+        top   = 0;
+    }
+
+    void release() {
+        for (const Chunk &c : chunks) LimbAllocator<uint32_t>().deallocate(c.data, c.size);
+        chunks.clear();
+        chunk = top = capacity = 0;
+    }
+
+    ~Arena() { release(); }
+};
+
+thread_local Arena t_arena;
+
+} // namespace
+
+ScratchStats scratch_stats() { return t_arena.stats; }
+
+void scratch_reset_stats() { t_arena.stats = {}; }
+
+void scratch_reserve(size_t limbs) { t_arena.ensure(limbs); }
+
+ScratchFrame::ScratchFrame()
+    : chunk_(t_arena.chunk), top_(t_arena.top), in_use_(t_arena.in_use) {
+    ++t_arena.depth;
+}
+
+ScratchFrame::~ScratchFrame() {
+    Arena &a = t_arena;
+    a.chunk  = chunk_;
+    a.top    = top_;
+    a.in_use = in_use_;
+    if (--a.depth == 0 && a.capacity > SCRATCH_KEEP_LIMBS) a.release();
+}
+
+uint32_t *ScratchFrame::alloc(size_t limbs) {
+    Arena &a = t_arena;
+    // Каждый блок - с границы 16 байт, как у malloc
+    limbs = (limbs + 3) & ~size_t{3};
+    a.ensure(limbs);
+    uint32_t *p = a.chunks[a.chunk].data + a.top;
+    a.top    += limbs;
+    a.in_use += limbs;
+    a.stats.peak_bytes = std::max(a.stats.peak_bytes, a.in_use * sizeof(uint32_t));
+    return p;
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Стековая (bump) арена для временных лимбов внутри операций (внутреннее для bignum.cpp).
+// У каждого потока своя. Память выдаётся кадрами: ScratchFrame запоминает вершину,
+// alloc сдвигает её, деструктор кадра возвращает обратно. Освобождение бесплатное и
+// строго в обратном порядке - как раз как в рекурсии (to_decimal, дальше - Карацуба).
+// Если операция заранее знает, сколько ей нужно, она резервирует это одним куском
+// (scratch_reserve), и дальше по ходу malloc не вызывается ни разу
+
+// Статистика арены текущего потока с последнего scratch_reset_stats
+struct ScratchStats {
+    size_t system_allocs = 0; // сколько раз арена брала память у системы
+    size_t peak_bytes    = 0; // максимум одновременно занятого
+};
+
+ScratchStats scratch_stats();
+void scratch_reset_stats();
+
+// Гарантирует, что следующие выделения общим размером до limbs лимбов
+// пройдут без обращения к системе
+void scratch_reserve(size_t limbs);
+
+class ScratchFrame {
+public:
+    ScratchFrame();
+    ~ScratchFrame();
+    ScratchFrame(const ScratchFrame &) = delete;
+    ScratchFrame &operator=(const ScratchFrame &) = delete;
+
+    // Неинициализированные limbs лимбов, живут до конца кадра
+    uint32_t *alloc(size_t limbs);
+
+private:
+    size_t chunk_, top_, in_use_;
+};
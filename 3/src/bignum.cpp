@@ -1,5 +1,11 @@
 #include "bignum.hpp"
+#include "arena.hpp"
+#include "fixed.hpp"
+#include "limbs.hpp"
+#include "profile.hpp"
 
+#include <algorithm>
+#include <bit>
 #include <stdexcept>
 #include <string>
 #include <unordered_map>
@@ -44,43 +50,179 @@ static void normalize(BigNum &a) {
 static BigNum zero_bn() { return {0}; }
 static BigNum one_bn()  { return {1}; }
 
+// То же для временных массивов лимбов (из арены): длина без ведущих нулей, у нуля - 0
+static size_t significant_limbs(const uint32_t *a, size_t n) {
+    while (n > 0 && a[n - 1] == 0) --n;
+    return n;
+}
+
+// Сравнение массивов лимбов без ведущих нулей
+static int cmp_limbs(const uint32_t *a, size_t na, const uint32_t *b, size_t nb) {
+    if (na != nb) return na < nb ? -1 : 1;
+    for (size_t i = na; i-- > 0; )
+        if (a[i] != b[i]) return a[i] < b[i] ? -1 : 1;
+    return 0;
+}
+
+// Деление на массивах лимбов (сам алгоритм - в разделе "Деление")
+static size_t divmod_scratch_limbs(size_t na, size_t nb);
+static void divmod_limbs(const uint32_t *a, size_t na, const uint32_t *b, size_t nb,
+                         uint32_t *q, uint32_t *r, uint32_t *scratch);
+
+// Биты
+// Сдвиги на целые лимбы - просто вставка/удаление лимбов, остаток сдвига
+// (0..31 бит) - циклами limbs_lshift/limbs_rshift из limbs.cpp
+
+size_t bignum_bit_length(const BigNum &a) {
+    size_t n = a.size();
+    while (n > 0 && a[n - 1] == 0) --n;
+    if (n == 0) return 0;
+    return (n - 1) * 32 + std::bit_width(a[n - 1]);
+}
+
+size_t bignum_popcount(const BigNum &a) {
+    size_t count = 0;
+    for (uint32_t limb : a) count += std::popcount(limb);
+    return count;
+}
+
+size_t bignum_ctz(const BigNum &a) {
+    for (size_t i = 0; i < a.size(); ++i)
+        if (a[i] != 0) return i * 32 + std::countr_zero(a[i]);
+    return 0;
+}
+
+BigNum bignum_shl(const BigNum &a, size_t bits) {
+    ProfScope prof(ProfKernel::Shift);
+    if (bignum_is_zero(a)) return zero_bn();
+    size_t   limbs = bits / 32;
+    unsigned cnt   = bits % 32;
+    // Младшие limbs лимбов - нули, выше - a и лимб под выдвинутые биты
+    BigNum r(limbs + a.size() + 1, 0);
+    if (cnt == 0) std::copy(a.begin(), a.end(), r.begin() + limbs);
+    else          r.back() = limbs_lshift(&r[limbs], a.data(), a.size(), cnt);
+    normalize(r);
+    return r;
+}
+
+BigNum bignum_shr(const BigNum &a, size_t bits) {
+    ProfScope prof(ProfKernel::Shift);
+    size_t limbs = bits / 32;
+    if (limbs >= a.size()) return zero_bn();
+    unsigned cnt = bits % 32;
+    BigNum r(a.begin() + limbs, a.end());
+    if (cnt != 0) limbs_rshift(r.data(), r.data(), r.size(), cnt);
+    normalize(r);
+    return r;
+}
+
+// Побитовые операции: лимб с лимбом, недостающие старшие лимбы короткого - нули.
+// Для and длина результата - по короткому, для or/xor - по длинному
+BigNum bignum_and(const BigNum &a, const BigNum &b) {
+    size_t n = std::min(a.size(), b.size());
+    BigNum r(n);
+    for (size_t i = 0; i < n; ++i) r[i] = a[i] & b[i];
+    normalize(r);
+    return r;
+}
+
+BigNum bignum_or(const BigNum &a, const BigNum &b) {
+    const BigNum &lng = a.size() >= b.size() ? a : b;
+    const BigNum &sht = a.size() >= b.size() ? b : a;
+    BigNum r = lng;
+    for (size_t i = 0; i < sht.size(); ++i) r[i] |= sht[i];
+    return r;
+}
+
+BigNum bignum_xor(const BigNum &a, const BigNum &b) {
+    const BigNum &lng = a.size() >= b.size() ? a : b;
+    const BigNum &sht = a.size() >= b.size() ? b : a;
+    BigNum r = lng;
+    for (size_t i = 0; i < sht.size(); ++i) r[i] ^= sht[i];
+    normalize(r);
+    return r;
+}
+
+// Если a = 2^k, пишет k и возвращает true. Сверху вниз: у случайного числа
+// ненулевой лимб под старшим находится сразу, так что проверка почти бесплатная
+static bool pow2_exponent(const BigNum &a, size_t &k) {
+    size_t n = a.size();
+    while (n > 0 && a[n - 1] == 0) --n;
+    if (n == 0 || !std::has_single_bit(a[n - 1])) return false;
+    for (size_t i = n - 1; i-- > 0; )
+        if (a[i] != 0) return false;
+    k = (n - 1) * 32 + std::countr_zero(a[n - 1]);
+    return true;
+}
+
 // Преобразование
 
-BigNum bignum_from_decimal(const std::string &s) {
+// a = a * mul + add (на месте), mul и add помещаются в одно слово
+static void mul_small_add(BigNum &a, uint32_t mul, uint32_t add) {
+    uint64_t carry = add;
+    for (auto &limb : a) {
+        uint64_t cur = static_cast<uint64_t>(limb) * mul + carry;
+        limb  = static_cast<uint32_t>(cur);        // младшие 32 бита
+        carry = cur >> 32;                          // перенос
+    }
+    if (carry) a.push_back(static_cast<uint32_t>(carry));
+}
+
+// Цифры берём пачками по 9: 10^9 < 2^32, поэтому пачка - это одно умножение
+// всего числа на 10^9 вместо девяти умножений на 10
+static constexpr size_t DEC_CHUNK_DIGITS = 9;
+
+static const uint32_t POW10_U32[DEC_CHUNK_DIGITS + 1] = {
+    1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000,
+};
+
+BigNum bignum_from_decimal(std::string_view s) {
+    ProfScope prof(ProfKernel::FromDecimal);
     if (s.empty() || s == "0") return zero_bn();
     BigNum result = {0};
-    for (char c : s) {
-        // result = result * 10 + digit
-        uint64_t carry = static_cast<uint64_t>(c - '0');
-        for (auto &limb : result) {
-            uint64_t cur = static_cast<uint64_t>(limb) * 10 + carry;
-            limb  = static_cast<uint32_t>(cur);        // младшие 32 бита
-            carry = cur >> 32;                          // перенос
-        }
-        if (carry) result.push_back(static_cast<uint32_t>(carry));
+    result.reserve(s.size() / 9 + 2); // 9.63 цифры на лимб
+    // Первая пачка неполная, чтобы остальные были ровно по 9 цифр
+    size_t first = s.size() % DEC_CHUNK_DIGITS;
+    if (first == 0) first = DEC_CHUNK_DIGITS;
+    for (size_t pos = 0, len = first; pos < s.size(); pos += len, len = DEC_CHUNK_DIGITS) {
+        uint32_t chunk = 0;
+        for (size_t i = pos; i < pos + len; ++i)
+            chunk = chunk * 10 + static_cast<uint32_t>(s[i] - '0');
+        // result = result * 10^len + chunk
+        mul_small_add(result, POW10_U32[len], chunk);
     }
     normalize(result);
     return result;
 }
 
-// Умножает десятичную строку на множитель и прибавляет слагаемое (на месте).
-static void decimal_mul_add(std::string &s, uint64_t factor, uint64_t addend) {
-    uint64_t carry = addend;
-    for (int i = static_cast<int>(s.size()) - 1; i >= 0; --i) {
-        uint64_t v = static_cast<uint64_t>(s[i] - '0') * factor + carry;
-        s[i] = static_cast<char>('0' + v % 10);
-        carry = v / 10;
-    }
-    while (carry) {
-        s.insert(s.begin(), static_cast<char>('0' + carry % 10));
-        carry /= 10;
+bool bignum_parse_decimal(std::string_view s, BigNum &out, const std::atomic<bool> *cancel) {
+    ProfScope prof(ProfKernel::FromDecimal);
+    if (s.empty()) return false;
+    if (s.size() > 1 && s[0] == '0') return false; // ведущие нули
+    out.assign(1, 0);
+    out.reserve(s.size() / 9 + 2);
+    size_t first = s.size() % DEC_CHUNK_DIGITS;
+    if (first == 0) first = DEC_CHUNK_DIGITS;
+    for (size_t pos = 0, len = first; pos < s.size(); pos += len, len = DEC_CHUNK_DIGITS) {
+        // Пачка - проход по всему числу, так что проверка флага на её фоне бесплатна
+        if (cancel && cancel->load(std::memory_order_relaxed)) return false;
+        uint32_t chunk = 0;
+        // Проверяем символ в том же цикле, где его накапливаем - второго прохода нет
+        for (size_t i = pos; i < pos + len; ++i) {
+            uint32_t d = static_cast<uint32_t>(static_cast<unsigned char>(s[i])) - '0';
+            if (d > 9) return false;
+            chunk = chunk * 10 + d;
+        }
+        mul_small_add(out, POW10_U32[len], chunk);
     }
+    normalize(out);
+    return true;
 }
 
-// Количество десятичных цифр в BigNum (оценка сверху)
-static size_t decimal_digits_estimate(const BigNum &a) {
+// Количество десятичных цифр в числе из limbs лимбов (оценка сверху)
+static size_t decimal_digits_estimate(size_t limbs) {
     // 32 * log10(2) ≈ 9.6329
-    return a.size() * 9633 / 1000 + 1;
+    return limbs * 9633 / 1000 + 1;
 }
 
 using Pow10Cache = std::unordered_map<size_t, BigNum>;
@@ -90,6 +232,7 @@ static const BigNum &bignum_pow10_cached(size_t k, Pow10Cache &cache) {
     auto it = cache.find(k);
     if (it != cache.end()) return it->second;
 
+    ProfScope prof(ProfKernel::Pow10); // только промахи кэша
     BigNum result;
     if (k == 0)      result = {1};
     else if (k == 1) result = {10};
@@ -109,38 +252,382 @@ static const BigNum &bignum_pow10_cached(size_t k, Pow10Cache &cache) {
 // Порог: при малых числах использование divmod становится дороже посимвольной конвертации
 static constexpr size_t DC_THRESHOLD_LIMBS = 32; // ~300 десятичных цифр
 
-static std::string to_decimal_dc(const BigNum &a, Pow10Cache &cache) {
-    // Базовый случай: наивная конвертация
-    if (a.size() <= DC_THRESHOLD_LIMBS) {
-        if (bignum_is_zero(a)) return "0";
-        std::string result = "0";
-        for (int i = static_cast<int>(a.size()) - 1; i >= 0; --i)
-            decimal_mul_add(result, 0x100000000ULL, a[i]);
-        return result;
+// Выдаёт в sink нули блоками, а не по одному символу
+static void emit_zeros(size_t count, const DecimalSink &sink) {
+    ProfScope prof(ProfKernel::Pad);
+    static const std::string ZEROS(1024, '0');
+    while (count > 0) {
+        size_t n = std::min(count, ZEROS.size());
+        sink(std::string_view(ZEROS).substr(0, n));
+        count -= n;
+    }
+}
+
+// Цифры выдаются в sink слева направо по мере готовности, полная строка нигде не собирается.
+// pad: дополнить нулями слева ровно до width цифр (нужно для младших половин).
+// Половины числа живут в арене: на каждом уровне hi и lo вместе занимают n + 1 лимб,
+// так что вся рекурсия укладывается в один заранее посчитанный кусок (dc_scratch_limbs)
+static void to_decimal_dc(const uint32_t *a, size_t n, bool pad, size_t width,
+                          Pow10Cache &cache, const DecimalSink &sink) {
+    ProfScope prof(ProfKernel::ToDecimal);
+    n = significant_limbs(a, n);
+    // Базовый случай: пачки по 9 цифр делением на 10^9, всё на стеке
+    if (n <= DC_THRESHOLD_LIMBS) {
+        uint32_t t[DC_THRESHOLD_LIMBS];
+        char     buf[DC_THRESHOLD_LIMBS * 10]; // 9.63 цифры на лимб
+        size_t   pos = sizeof(buf);
+        std::copy(a, a + n, t);
+        while (n > 0) {
+            uint64_t rem = 0;
+            for (size_t i = n; i-- > 0; ) {
+                uint64_t cur = (rem << 32) | t[i];
+                t[i] = static_cast<uint32_t>(cur / POW10_U32[DEC_CHUNK_DIGITS]);
+                rem  = cur % POW10_U32[DEC_CHUNK_DIGITS];
+            }
+            n = significant_limbs(t, n);
+            // У старшей пачки ведущие нули не пишем
+            for (size_t d = 0; d < DEC_CHUNK_DIGITS && (n > 0 || rem != 0); ++d) {
+                buf[--pos] = static_cast<char>('0' + rem % 10);
+                rem /= 10;
+            }
+        }
+        size_t len = sizeof(buf) - pos;
+        if (len == 0) {
+            if (pad) emit_zeros(width, sink);
+            else     sink("0");
+            return;
+        }
+        if (pad && len < width)
+            emit_zeros(width - len, sink);
+        sink(std::string_view(buf + pos, len));
+        return;
     }
 
     // Разбиваем N = hi * 10^k + lo, где k ≈ D/2 (половина десятичных цифр)
-    size_t k = decimal_digits_estimate(a) / 2;
+    size_t k = decimal_digits_estimate(n) / 2;
 
     const BigNum &mid = bignum_pow10_cached(k, cache);
-    auto [hi, lo] = bignum_divmod(a, mid);
+    size_t       nm  = mid.size();
+    ScratchFrame frame;
+    uint32_t *hi = frame.alloc(n - nm + 1);
+    uint32_t *lo = frame.alloc(nm);
+    {
+        ScratchFrame div;
+        divmod_limbs(a, n, mid.data(), nm, hi, lo, div.alloc(divmod_scratch_limbs(n, nm)));
+    }
 
-    std::string hi_str = to_decimal_dc(hi, cache);
-    std::string lo_str = to_decimal_dc(lo, cache);
+    // Старшая половина идёт первой; если дополнялось всё число, то дополняется и она
+    to_decimal_dc(hi, n - nm + 1, pad, pad ? width - k : 0, cache, sink);
+    // lo < 10^k, поэтому у lo не более k цифр; дополняем нулями слева до ровно k
+    to_decimal_dc(lo, nm, true, k, cache, sink);
+}
 
-    // lo < 10^k, поэтому lo_str имеет не более k цифр;
-    // дополняем нулями слева до ровно k символов
-    if (lo_str.size() < k)
-        lo_str.insert(0, k - lo_str.size(), '0');
+// Оценка сверху памяти арены под to_decimal_dc для числа из n лимбов: на уровне
+// hi и lo (n + 1) плюс либо рабочая память деления, либо более глубокие уровни
+// (и по 3 лимба на выравнивание каждого из трёх блоков уровня).
+// 10^k занимает от k*log2(10)/32 до этого + 2 лимбов (log2(10) ≈ 3.3219281), отсюда длины половин
+static size_t dc_scratch_limbs(size_t n) {
+    if (n <= DC_THRESHOLD_LIMBS) return 0;
+    size_t k     = decimal_digits_estimate(n) / 2;
+    size_t nm_lo = k * 3321928 / 32000000;
+    size_t nm_hi = k * 3321929 / 32000000 + 2;
+    size_t child = std::max(n - nm_lo + 1, nm_hi);
+    return (n + 1) + 9 + std::max(divmod_scratch_limbs(n, nm_hi), dc_scratch_limbs(child));
+}
 
-    return hi_str + lo_str;
+void bignum_write_decimal(const BigNum &a, const DecimalSink &sink) {
+    if (bignum_is_zero(a)) {
+        sink("0");
+        return;
+    }
+    Pow10Cache cache;
+    scratch_reserve(dc_scratch_limbs(a.size()));
+    to_decimal_dc(a.data(), a.size(), false, 0, cache, sink);
 }
 
-// Нужна для создания кэша степеней только один раз
+// Строка собирается тем же потоковым конвертером в заранее выделенный буфер
 std::string bignum_to_decimal(const BigNum &a) {
-    if (bignum_is_zero(a)) return "0";
+    std::string result;
+    result.reserve(decimal_digits_estimate(a.size()));
+    bignum_write_decimal(a, [&result](std::string_view chunk) { result.append(chunk); });
+    return result;
+}
+
+// Длина и фрагменты десятичной записи без полной конвертации
+
+// Приближённые числа для начала десятичной записи: значение = mant * 2^(32*exp),
+// в mant не больше prec лимбов. Отбрасывание младших лимбов даёт нижнюю границу,
+// +1 к mant - верхнюю. Считая обе, получаем честный интервал и понимаем, когда
+// точности не хватило (тогда вызывающий переходит на точный, медленный путь)
+struct Approx {
+    BigNum mant;
+    size_t exp = 0;
+};
+
+static Approx approx_lower(BigNum m, size_t exp, size_t prec) {
+    normalize(m);
+    if (m.size() > prec) {
+        size_t drop = m.size() - prec;
+        m.erase(m.begin(), m.begin() + static_cast<std::ptrdiff_t>(drop));
+        exp += drop;
+    }
+    return {std::move(m), exp};
+}
+
+static Approx approx_upper(BigNum m, size_t exp, size_t prec) {
+    size_t before = m.size();
+    Approx r = approx_lower(std::move(m), exp, prec);
+    if (r.exp > exp || r.mant.size() < before) // что-то отброшено - округляем вверх
+        r.mant = bignum_add(r.mant, one_bn());
+    return r;
+}
+
+// Границы 10^m: быстрое возведение в степень, каждое произведение обрезается до prec лимбов
+static std::pair<Approx, Approx> approx_pow10(size_t m, size_t prec) {
+    Approx lo{one_bn(), 0}, hi{one_bn(), 0};
+    const BigNum ten = {10};
+    for (int bit = 63; bit >= 0; --bit) {
+        lo = approx_lower(bignum_mul(lo.mant, lo.mant), lo.exp * 2, prec);
+        hi = approx_upper(bignum_mul(hi.mant, hi.mant), hi.exp * 2, prec);
+        if ((m >> bit) & 1) {
+            lo = approx_lower(bignum_mul(lo.mant, ten), lo.exp, prec);
+            hi = approx_upper(bignum_mul(hi.mant, ten), hi.exp, prec);
+        }
+    }
+    return {std::move(lo), std::move(hi)};
+}
+
+// Сдвиг на целые лимбы влево
+static BigNum shl_limbs(const BigNum &a, size_t limbs) {
+    BigNum r(limbs, 0);
+    r.insert(r.end(), a.begin(), a.end());
+    return r;
+}
+
+// floor(x / y) для приближённых x, y
+static BigNum approx_div_floor(const Approx &x, const Approx &y) {
+    if (x.exp >= y.exp)
+        return bignum_divmod(shl_limbs(x.mant, x.exp - y.exp), y.mant).first;
+    return bignum_divmod(x.mant, shl_limbs(y.mant, y.exp - x.exp)).first;
+}
+
+// Сравнение приближённых x и y
+static int approx_cmp(const Approx &x, const Approx &y) {
+    if (x.exp >= y.exp)
+        return bignum_cmp(shl_limbs(x.mant, x.exp - y.exp), y.mant);
+    return bignum_cmp(x.mant, shl_limbs(y.mant, y.exp - x.exp));
+}
+
+// Точности в 4 лимба хватает, чтобы отличить число от степени десяти,
+// если только оно не отличается от неё меньше чем в 2^-96 раз (вроде 999...9)
+static constexpr size_t LENGTH_PREC_LIMBS = 4;
+
+// Степени десяти для bignum_decimal_digits. Подписи в интерфейсе спрашивают длину
+// одних и тех же чисел на каждой перерисовке, поэтому границы 10^k запоминаются
+// (их немного: по одной на длину числа), а точная степень - только последняя,
+// она нужна лишь для чисел вплотную к 10^k
+struct DigitsPow10Cache {
+    static constexpr size_t MAX_APPROX = 256;
+
+    std::unordered_map<size_t, std::pair<Approx, Approx>> approx;
+    size_t exact_k = 0;
+    BigNum exact;
+
+    const std::pair<Approx, Approx> &bounds(size_t k) {
+        auto it = approx.find(k);
+        if (it != approx.end()) return it->second;
+        if (approx.size() >= MAX_APPROX) approx.clear();
+        return approx.emplace(k, approx_pow10(k, LENGTH_PREC_LIMBS)).first->second;
+    }
+
+    const BigNum &power(size_t k) {
+        if (exact.empty() || exact_k != k) {
+            Pow10Cache cache;
+            exact   = bignum_pow10_cached(k, cache);
+            exact_k = k;
+        }
+        return exact;
+    }
+};
+
+static DigitsPow10Cache &digits_pow10_cache() {
+    thread_local DigitsPow10Cache cache;
+    return cache;
+}
+
+size_t bignum_decimal_digits(const BigNum &a) {
+    ProfScope prof(ProfKernel::Digits);
+    size_t bits = bignum_bit_length(a);
+    if (bits == 0) return 1;
+    // 2^(bits-1) <= a < 2^bits, поэтому цифр от floor((bits-1)*log10(2))+1 до floor(bits*log10(2))+1.
+    // log10(2) берём с 19 знаками снизу и сверху, чтобы границы были честными
+    constexpr unsigned __int128 LOG10_2_LO = 3010299956639811952ULL; // * 10^-19
+    constexpr unsigned __int128 LOG10_2_HI = 3010299956639811953ULL;
+    constexpr unsigned __int128 SCALE      = 10000000000000000000ULL;
+    size_t lo = static_cast<size_t>((bits - 1) * LOG10_2_LO / SCALE) + 1;
+    size_t hi = static_cast<size_t>(bits * LOG10_2_HI / SCALE) + 1;
+    // Обычно границы совпадают (hi - lo <= 1); иначе одно сравнение a с 10^lo.
+    // Сначала по старшим лимбам a и запомненным границам степени
+    if (lo == hi) return lo;
+    size_t n    = significant_limbs(a.data(), a.size());
+    size_t drop = n > LENGTH_PREC_LIMBS ? n - LENGTH_PREC_LIMBS : 0;
+    Approx a_lo{BigNum(a.begin() + static_cast<std::ptrdiff_t>(drop), a.begin() + static_cast<std::ptrdiff_t>(n)), drop};
+    Approx a_hi{drop > 0 ? bignum_add(a_lo.mant, one_bn()) : a_lo.mant, drop};
+    DigitsPow10Cache &cache = digits_pow10_cache();
+    const auto &[p_lo, p_hi] = cache.bounds(lo);
+    if (approx_cmp(a_lo, p_hi) >= 0) return hi; // a >= 10^lo
+    if (approx_cmp(a_hi, p_lo) < 0)  return lo; // a < 10^lo
+    // Число почти равно степени десяти - сравниваем точно
+    return bignum_cmp(a, cache.power(lo)) >= 0 ? hi : lo;
+}
+
+std::string bignum_decimal_slice(const BigNum &a, size_t from, size_t count) {
+    ProfScope prof(ProfKernel::Digits);
+    size_t digits = bignum_decimal_digits(a);
+    if (from >= digits || count == 0) return "";
+    count = std::min(count, digits - from);
+
+    // Цифры [from, from + count) - это (a / 10^below) mod 10^count.
+    // Частное или остаток каждый раз короткое, так что деление линейно по длине a
+    size_t     below = digits - from - count;
     Pow10Cache cache;
-    return to_decimal_dc(a, cache);
+    BigNum     x = a;
+    if (below > 0)
+        x = bignum_divmod(x, bignum_pow10_cached(below, cache)).first;
+    if (from > 0)
+        x = bignum_divmod(x, bignum_pow10_cached(count, cache)).second;
+
+    std::string result = bignum_to_decimal(x);
+    // Внутри числа фрагмент может начинаться с нулей
+    if (result.size() < count)
+        result.insert(0, count - result.size(), '0');
+    return result;
+}
+
+std::string bignum_leading_digits(const BigNum &a, size_t k) {
+    ProfScope prof(ProfKernel::Digits);
+    size_t digits = bignum_decimal_digits(a);
+    if (k >= digits) return bignum_to_decimal(a);
+    if (k == 0) return "";
+
+    // floor(a / 10^m), m = digits - k. Вместо точной 10^m (размером почти с a)
+    // берём её приближение с точностью чуть больше k цифр: деление получается
+    // на коротких числах, а интервал [a_lo / p_hi, a_hi / p_lo] гарантирует ответ
+    size_t m    = digits - k;
+    size_t prec = k / 9 + 4;
+    Approx a_lo = approx_lower(a, 0, prec);
+    Approx a_hi = approx_upper(a, 0, prec);
+    auto [p_lo, p_hi] = approx_pow10(m, prec);
+    BigNum q_lo = approx_div_floor(a_lo, p_hi);
+    BigNum q_hi = approx_div_floor(a_hi, p_lo);
+    if (bignum_cmp(q_lo, q_hi) == 0)
+        return bignum_to_decimal(q_lo);
+    // Следующие за k-й цифры - почти сплошь 9 или 0, приближения не хватило
+    return bignum_decimal_slice(a, 0, k);
+}
+
+std::string bignum_trailing_digits(const BigNum &a, size_t k) {
+    ProfScope prof(ProfKernel::Digits);
+    size_t digits = bignum_decimal_digits(a);
+    if (k >= digits) return bignum_to_decimal(a);
+    if (k == 0) return "";
+
+    // a mod 10^k: делитель короткий, поэтому деление линейно по длине a
+    Pow10Cache cache;
+    std::string result = bignum_to_decimal(bignum_divmod(a, bignum_pow10_cached(k, cache)).second);
+    if (result.size() < k)
+        result.insert(0, k - result.size(), '0');
+    return result;
+}
+
+// Инкрементальный разбор
+// Правка десятичной строки меняет число арифметически, без разбора всех цифр заново
+
+// a -= b (на месте), требуется a >= b
+static void sub_in_place(BigNum &a, const BigNum &b) {
+    size_t   nb     = std::min(a.size(), b.size());
+    uint32_t borrow = limbs_sub_n(a.data(), a.data(), b.data(), nb);
+    // Заём идёт дальше по старшим лимбам a, пока не упрётся в ненулевой
+    for (size_t i = nb; borrow && i < a.size(); ++i)
+        borrow = (a[i]-- == 0);
+    normalize(a);
+}
+
+// a *= 10^k, пачками по 10^9 за проход
+static void mul_pow10_small(BigNum &a, size_t k) {
+    if (bignum_is_zero(a)) return;
+    while (k > 0) {
+        size_t step = std::min(k, DEC_CHUNK_DIGITS);
+        mul_small_add(a, POW10_U32[step], 0);
+        k -= step;
+    }
+}
+
+// a /= 10^k, деление нацело на одно слово за проход; правка гарантирует делимость
+static void div_pow10_small(BigNum &a, size_t k) {
+    while (k > 0) {
+        size_t   step = std::min(k, DEC_CHUNK_DIGITS);
+        uint64_t d    = POW10_U32[step];
+        uint64_t rem  = 0;
+        for (int i = static_cast<int>(a.size()) - 1; i >= 0; --i) {
+            uint64_t cur = (rem << 32) | a[i];
+            a[i] = static_cast<uint32_t>(cur / d);
+            rem  = cur % d;
+        }
+        k -= step;
+    }
+    normalize(a);
+}
+
+// Если правка больше этой доли числа (в цифрах), полный разбор не хуже
+static constexpr size_t UPDATE_MAX_FRACTION = 2;
+
+bool bignum_update_decimal(BigNum &value, std::string_view old_digits, std::string_view new_digits) {
+    size_t n = old_digits.size(), m = new_digits.size();
+    if (n == 0 || m == 0) return false;
+
+    // Общие начало и конец; между ними - изменённый участок
+    size_t p = 0;
+    while (p < n && p < m && old_digits[p] == new_digits[p]) ++p;
+    size_t q = 0;
+    while (q < n - p && q < m - p && old_digits[n - 1 - q] == new_digits[m - 1 - q]) ++q;
+    if (p == n && p == m) return true; // ничего не изменилось
+
+    size_t old_mid = n - p - q, new_mid = m - p - q;
+    size_t digits  = std::max(n, m);
+
+    if (old_mid == new_mid) {
+        // Замена цифр на месте: V' = V ± |M' - M| * 10^q
+        if (old_mid * UPDATE_MAX_FRACTION > digits) return false;
+        BigNum before = bignum_from_decimal(old_digits.substr(p, old_mid));
+        BigNum after  = bignum_from_decimal(new_digits.substr(p, new_mid));
+        bool grow = bignum_cmp(after, before) >= 0;
+        BigNum delta = grow ? after : before;
+        sub_in_place(delta, grow ? before : after);
+        if (q > 0) {
+            Pow10Cache cache;
+            delta = bignum_mul(delta, bignum_pow10_cached(q, cache));
+        }
+        if (grow) value = bignum_add(value, delta);
+        else      sub_in_place(value, delta);
+        return true;
+    }
+
+    // Длина изменилась: всё, что правее первого отличия, - хвост T (k цифр), V = H * 10^k + T.
+    // Тогда V' = H * 10^k' + T', где H = (V - T) / 10^k. Стоимость - разбор хвостов
+    // плюс сдвиг на |k' - k| цифр, так что выгодно только для правок ближе к концу числа
+    size_t k = n - p, k_new = m - p;
+    size_t shift = (k > k_new) ? k - k_new : k_new - k;
+    if (std::max(k, k_new) * UPDATE_MAX_FRACTION > digits) return false;
+    if (shift * 16 > digits) return false; // каждый сдвиг на 9 цифр - проход по всему числу
+
+    BigNum tail_old = bignum_from_decimal(old_digits.substr(p));
+    BigNum tail_new = bignum_from_decimal(new_digits.substr(p));
+    sub_in_place(value, tail_old);
+    if (k_new > k) mul_pow10_small(value, shift);
+    else           div_pow10_small(value, shift);
+    value = bignum_add(value, tail_new);
+    return true;
 }
 
 // Предикаты
@@ -151,7 +638,7 @@ bool bignum_is_zero(const BigNum &a) {
     return true;
 }
 
-bool bignum_is_valid_decimal(const std::string &s) {
+bool bignum_is_valid_decimal(std::string_view s) {
     if (s.empty()) return false;
     for (char c : s)
         if (c < '0' || c > '9') return false;
@@ -182,17 +669,18 @@ int bignum_cmp(const BigNum &a, const BigNum &b) {
 // Сложение
 
 BigNum bignum_add(const BigNum &a, const BigNum &b) {
+    ProfScope prof(ProfKernel::Add);
     // Результат может быть на 1 слово длиннее максимального из входных чисел,
     // если есть перенос из старшего разряда
-    size_t n = std::max(a.size(), b.size());
+    const BigNum &lng = a.size() >= b.size() ? a : b;
+    const BigNum &sht = a.size() >= b.size() ? b : a;
+    size_t n = lng.size();
     BigNum result(n + 1, 0);
-    uint64_t carry = 0;
-    for (size_t i = 0; i < n; ++i) {
-        uint64_t av = (i < a.size()) ? a[i] : 0;
-        uint64_t bv = (i < b.size()) ? b[i] : 0;
-        uint64_t sum = av + bv + carry;
-        // Младшие 32 (на самом деле 1 разряд) бита результата записываем в число
-        // Старшие 32 бита переносим на след итерацию
+    // Общая часть - циклом из limbs.cpp (младшие 32 бита суммы в число, старшие - в перенос)
+    uint64_t carry = limbs_add_n(result.data(), lng.data(), sht.data(), sht.size());
+    // Остаток длинного числа - только с переносом
+    for (size_t i = sht.size(); i < n; ++i) {
+        uint64_t sum = lng[i] + carry;
         result[i] = static_cast<uint32_t>(sum);
         carry = sum >> 32;
     }
@@ -202,28 +690,74 @@ BigNum bignum_add(const BigNum &a, const BigNum &b) {
     return result;
 }
 
+// Вычитание (то самое, которого в задании нет)
+
+BigNum bignum_sub(const BigNum &a, const BigNum &b) {
+    ProfScope prof(ProfKernel::Sub);
+    if (bignum_cmp(a, b) < 0)
+        throw std::invalid_argument("Ошибка: вычитаемое больше уменьшаемого");
+    // Как сложение: общая часть циклом из limbs.cpp, остаток a - только с заёмом
+    size_t   nb     = std::min(a.size(), b.size());
+    BigNum   result(a.size());
+    uint32_t borrow = limbs_sub_n(result.data(), a.data(), b.data(), nb);
+    for (size_t i = nb; i < a.size(); ++i) {
+        result[i] = a[i] - borrow;
+        borrow    = borrow && a[i] == 0;
+    }
+    normalize(result);
+    return result;
+}
+
 // Умножение в столбик (спасибо организации ЭВМ, снова)
 
 BigNum bignum_mul(const BigNum &a, const BigNum &b) {
+    ProfScope prof(ProfKernel::Mul);
     if (bignum_is_zero(a) || bignum_is_zero(b)) return zero_bn();
+    // Умножение на степень двойки - сдвиг
+    size_t k;
+    if (pow2_exponent(b, k)) return bignum_shl(a, k);
+    if (pow2_exponent(a, k)) return bignum_shl(b, k);
+    BigNum fixed;
+    if (fixed_try_mul(a, b, fixed)) return fixed; // ширина из FIXED_WIDTHS (fixed.hpp)
     size_t na = a.size(), nb = b.size();
     // Результат будет максимум na + nb лимбов
     BigNum result(na + nb, 0);
     // Умножаем каждое слово a на каждое слово b
     for (size_t i = 0; i < na; ++i) {
-        // Тут почти как сложение, только произведение, и an раз
-        uint64_t carry = 0;
-        for (size_t j = 0; j < nb; ++j) {
-            uint64_t cur = static_cast<uint64_t>(a[i]) * b[j]
-                         + result[i + j] // Промежуточный результат с прошлой итерации i
-                         + carry;
-            // Младшие 32 бита (на самом деле 1 разряд) результата записываем в число
-            // Старшие 32 бита переносим на след итерацию
-            result[i + j] = static_cast<uint32_t>(cur);
-            carry = cur >> 32;
-        }
-        // Записываем перенос в следующий старший разряд
-        result[i + nb] += static_cast<uint32_t>(carry);
+        // Тут почти как сложение, только произведение, и an раз:
+        // result[i..i+nb) += b * a[i] (промежуточный результат с прошлых i плюс
+        // новая строка), перенос - в следующий старший разряд
+        result[i + nb] += limbs_addmul_1(&result[i], b.data(), nb, a[i]);
+    }
+    normalize(result);
+    return result;
+}
+
+// Квадрат: каждое произведение a[i]*a[j] при i != j встречается дважды,
+// поэтому считаем только половину, удваиваем сдвигом и добавляем диагональ a[i]^2.
+// Примерно вдвое меньше умножений, чем bignum_mul(a, a)
+
+BigNum bignum_sqr(const BigNum &a) {
+    ProfScope prof(ProfKernel::Sqr);
+    if (bignum_is_zero(a)) return zero_bn();
+    BigNum fixed;
+    if (fixed_try_sqr(a, fixed)) return fixed;
+    size_t n = a.size();
+    BigNum result(2 * n, 0);
+    // Произведения выше диагонали (i < j)
+    for (size_t i = 0; i + 1 < n; ++i) // выше по этой строке ещё ничего не писали
+        result[i + n] = limbs_addmul_1(&result[2 * i + 1], &a[i + 1], n - i - 1, a[i]);
+    // Удваиваем (сдвиг на бит влево; старший бит свободен, т.к. это меньше половины a^2)
+    limbs_lshift(result.data(), result.data(), 2 * n, 1);
+    // Добавляем квадраты на диагонали
+    uint64_t carry = 0;
+    for (size_t i = 0; i < n; ++i) {
+        uint64_t p  = static_cast<uint64_t>(a[i]) * a[i];
+        uint64_t lo = static_cast<uint64_t>(result[2 * i]) + (p & 0xFFFFFFFFULL) + carry;
+        result[2 * i] = static_cast<uint32_t>(lo);
+        uint64_t hi = static_cast<uint64_t>(result[2 * i + 1]) + (p >> 32) + (lo >> 32);
+        result[2 * i + 1] = static_cast<uint32_t>(hi);
+        carry = hi >> 32;
     }
     normalize(result);
     return result;
@@ -244,34 +778,70 @@ std::pair<BigNum, BigNum> bignum_divmod(const BigNum &a, const BigNum &b) {
     if (cmp < 0) return {zero_bn(), a};
     if (cmp == 0) return {one_bn(), zero_bn()};
 
+    // Деление на 2^k: частное - сдвиг вправо, остаток - младшие k бит
+    size_t k;
+    if (pow2_exponent(b, k)) {
+        if (k == 0) return {a, zero_bn()};
+        BigNum rem(a.begin(), a.begin() + (k + 31) / 32);
+        if (k % 32) rem.back() &= (1u << (k % 32)) - 1;
+        normalize(rem);
+        return {bignum_shr(a, k), rem};
+    }
+
+    // Делимое вдвое шире делителя из FIXED_WIDTHS - всё на стеке, без арены
+    {
+        ProfScope prof(ProfKernel::Divmod);
+        BigNum    fq, fr;
+        if (fixed_try_divmod(a, b, fq, fr)) return {std::move(fq), std::move(fr)};
+    }
+
+    // Сам алгоритм работает на массивах лимбов; копии для нормализации - в арене
+    size_t na = significant_limbs(a.data(), a.size());
+    size_t nb = significant_limbs(b.data(), b.size());
+    BigNum q(na - nb + 1), rem(nb);
+    ScratchFrame frame;
+    divmod_limbs(a.data(), na, b.data(), nb, q.data(), rem.data(), frame.alloc(divmod_scratch_limbs(na, nb)));
+    normalize(q);
+    normalize(rem);
+    return {q, rem}; // фух
+}
+
+// Рабочая память divmod_limbs: нормализованные копии делимого (с лишним лимбом) и делителя.
+// Делитель - с границы 16 байт: циклы из limbs.cpp читают его 64-битными словами
+static size_t divmod_u_limbs(size_t na) { return (na + 1 + 3) & ~size_t{3}; }
+
+static size_t divmod_scratch_limbs(size_t na, size_t nb) {
+    return divmod_u_limbs(na) + nb;
+}
+
+// q[0..na-nb] = a / b, r[0..nb) = a mod b (без нормализации). na >= nb, старший лимб b не ноль
+static void divmod_limbs(const uint32_t *a, size_t na, const uint32_t *b, size_t nb,
+                         uint32_t *q, uint32_t *r, uint32_t *scratch) {
+    ProfScope prof(ProfKernel::Divmod);
     // Копируем числа для нормализации и изменения на месте
     // Нормализация: домножать на нек. число (2), пока делитель не больше половины разряда (2^31)
     // то есть имеет старший бит старшего лимба равный 1
-    BigNum u = a, v = b;
-    normalize(u); normalize(v);
+    uint32_t *u = scratch, *v = scratch + divmod_u_limbs(na);
 
-    size_t n = v.size();
-    size_t m = u.size() - n; // тогда частное q имеет не более m+1 слов
+    size_t n = nb;
+    size_t m = na - n; // тогда частное q имеет не более m+1 слов
 
-    // Ищем нужный сдвиг
-    uint32_t msv = v.back();
-    int shift = 0;
-    while ((msv & (1u << 31)) == 0) { msv <<= 1; ++shift; }
+    // Нужный сдвиг - сколько нулей над старшим битом делителя
+    unsigned shift = static_cast<unsigned>(std::countl_zero(b[n - 1]));
 
-    // И сдвигаем каждый лимб u и v влево на shift бит, сохраняя перенос между словами
-    u.push_back(0);
+    // И сдвигаем u и v влево на shift бит (перенос между словами - внутри limbs_lshift),
+    // выдвинутые биты u уходят в новый старший лимб
     if (shift > 0) {
-        for (int i = static_cast<int>(u.size()) - 1; i > 0; --i)
-            u[i] = (u[i] << shift) | (u[i-1] >> (32 - shift));
-        u[0] <<= shift;
-
-        for (int i = static_cast<int>(v.size()) - 1; i > 0; --i)
-            v[i] = (v[i] << shift) | (v[i - 1] >> (32 - shift));
-        v[0] <<= shift;
+        u[na] = limbs_lshift(u, a, na, shift);
+        limbs_lshift(v, b, n, shift);
+    } else {
+        std::copy(a, a + na, u);
+        std::copy(b, b + n, v);
+        u[na] = 0;
     }
     // Нормализация завершена
 
-    BigNum q(m + 1, 0); // частное
+    // q - частное, m+1 слов
     uint64_t vn1 = v[n - 1]; // старший лимб делителя. Гарантированно >= 2^31
     uint64_t vn2 = (n >= 2) ? v[n - 2] : 0; // второй по старшинству лимб делителя (или 0, если его нет)
 
@@ -285,8 +855,10 @@ std::pair<BigNum, BigNum> bignum_divmod(const BigNum &a, const BigNum &b) {
         uint64_t qhat, rhat;
         // Оцениваем qhat сверху
         if (u_hi >= vn1) { // делимое больше делителя
+            // u_hi == vn1 (больше не бывает), остаток честный: u_hi*b + u_lo - qhat*vn1
+            // может вылезти за 32 бита — тогда уточнять нечего
             qhat = 0xFFFFFFFFULL; // максимум 2^32-1
-            rhat = u_hi - vn1 + u_lo; // приблизительно
+            rhat = u_lo + vn1;
         } else { // делимое меньше делителя, можно оценить qhat через обычное деление
             uint64_t num = (u_hi << 32) | u_lo;
             qhat = num / vn1; // а чо придумывать велосипед
@@ -296,26 +868,15 @@ std::pair<BigNum, BigNum> bignum_divmod(const BigNum &a, const BigNum &b) {
         // Уточняем qhat, т.к. при делении мы игнорировали младшие разряды
         // Пока восстановленное делимое больше реального, уменьшаем qhat
         // После этого он *всё ещё* может быть на единицу больше, чем нужно, но не больше
-        while (qhat * vn2 > ((rhat << 32) | u_lo2)) {
+        while (rhat <= 0xFFFFFFFFULL && qhat * vn2 > ((rhat << 32) | u_lo2)) {
             --qhat;
             rhat += vn1;
-            if (rhat > 0xFFFFFFFFULL) break;
         }
 
         // Вычитание столбиком (в задании вычитания нет, но пришлось сделать!!! везде обман!!!)
-        // u[j..j+n] - qhat * v[0..n-1], при этом умножаем прямо в цикле, без отдельной переменной
-        // в каждом j делаем u[j+i] - qhat * v[i] - borrow (с переносом с младших разрядов)
-        int64_t borrow = 0;
-        for (size_t i = 0; i < n; ++i) {
-            uint64_t p = qhat * v[i];
-            int64_t t = static_cast<int64_t>(u[j + i]) // из числа
-                      - static_cast<int64_t>(p & 0xFFFFFFFFULL) // вычитаем произведение (старшая часть пойдёт в перенос)
-                      - borrow; // и перенос из младших разрядов
-            // младший разряд записываем, старший разряд переносим
-            u[j + i] = static_cast<uint32_t>(t);
-            borrow = static_cast<int64_t>(p >> 32) - (t >> 32); // -1 или 0
-        }
-        // Под конец вычитаем перенос из старшего разряда
+        // u[j..j+n] - qhat * v[0..n-1], умножаем прямо в цикле, без отдельной переменной
+        // (limbs_submul_1), заём из старших разрядов вычитаем из u[j+n]
+        uint32_t borrow = limbs_submul_1(&u[j], v, n, static_cast<uint32_t>(qhat));
         int64_t t = static_cast<int64_t>(u[j + n]) - borrow;
         u[j + n] = static_cast<uint32_t>(t);
 
@@ -327,29 +888,76 @@ std::pair<BigNum, BigNum> bignum_divmod(const BigNum &a, const BigNum &b) {
         if (t < 0) {
             --q[j];
             // обычное сложение, прямо как bignum_add
-            uint64_t carry = 0;
-            for (size_t i = 0; i < n; ++i) {
-                uint64_t s = static_cast<uint64_t>(u[j + i]) + v[i] + carry;
-                u[j + i] = static_cast<uint32_t>(s);
-                carry = s >> 32;
-            }
-            u[j + n] += static_cast<uint32_t>(carry);
+            u[j + n] += limbs_add_n(&u[j], &u[j], v, n);
         }
     }
 
     // В u остался остаток (ха!). 
     // Сдвигаем его вправо на shift (делим на то, на что умножали в начале. В частном же умножения сократились сами)
-    BigNum rem(n);
-    for (size_t i = 0; i < n; ++i) rem[i] = u[i];
-    if (shift > 0) {
-        for (size_t i = 0; i < n - 1; ++i)
-            rem[i] = (rem[i] >> shift) | (rem[i + 1] << (32 - shift));
-        rem[n - 1] >>= shift;
-    }
+    if (shift > 0) limbs_rshift(r, u, n, shift);
+    else           std::copy(u, u + n, r);
+}
 
-    normalize(q);
-    normalize(rem);
-    return {q, rem}; // фух
+// Числа со знаком
+// Всё сводится к операциям над модулями: знак результата считается отдельно,
+// а сложение разных знаков - вычитание меньшего модуля из большего
+
+SignedBigNum sbignum_make(BigNum mag, bool neg) {
+    normalize(mag);
+    SignedBigNum r;
+    r.neg = neg && !bignum_is_zero(mag);
+    r.mag = std::move(mag);
+    return r;
+}
+
+SignedBigNum sbignum_from_decimal(std::string_view s) {
+    bool neg = !s.empty() && s[0] == '-';
+    if (neg) s.remove_prefix(1);
+    return sbignum_make(bignum_from_decimal(s), neg);
+}
+
+std::string sbignum_to_decimal(const SignedBigNum &a) {
+    std::string s = bignum_to_decimal(a.mag);
+    return a.neg ? "-" + s : s;
+}
+
+int sbignum_cmp(const SignedBigNum &a, const SignedBigNum &b) {
+    if (a.neg != b.neg) return a.neg ? -1 : 1;
+    int c = bignum_cmp(a.mag, b.mag);
+    return a.neg ? -c : c; // у отрицательных больше тот, чей модуль меньше
+}
+
+SignedBigNum sbignum_neg(const SignedBigNum &a) {
+    return sbignum_make(a.mag, !a.neg);
+}
+
+// |a| ± |b| со знаком sign_a у a и sign_b у b
+static SignedBigNum add_signed(const BigNum &a, bool sign_a, const BigNum &b, bool sign_b) {
+    if (sign_a == sign_b) return sbignum_make(bignum_add(a, b), sign_a);
+    // Знаки разные: из большего модуля вычитаем меньший, знак - как у большего
+    int c = bignum_cmp(a, b);
+    if (c == 0) return {};
+    BigNum r = c > 0 ? a : b;
+    sub_in_place(r, c > 0 ? b : a);
+    return sbignum_make(std::move(r), c > 0 ? sign_a : sign_b);
+}
+
+SignedBigNum sbignum_add(const SignedBigNum &a, const SignedBigNum &b) {
+    return add_signed(a.mag, a.neg, b.mag, b.neg);
+}
+
+SignedBigNum sbignum_sub(const SignedBigNum &a, const SignedBigNum &b) {
+    return add_signed(a.mag, a.neg, b.mag, !b.neg);
+}
+
+SignedBigNum sbignum_mul(const SignedBigNum &a, const SignedBigNum &b) {
+    BigNum mag = (&a == &b || a.mag == b.mag) ? bignum_sqr(a.mag) : bignum_mul(a.mag, b.mag);
+    return sbignum_make(std::move(mag), a.neg != b.neg);
+}
+
+std::pair<SignedBigNum, SignedBigNum> sbignum_divmod(const SignedBigNum &a, const SignedBigNum &b) {
+    auto [q, r] = bignum_divmod(a.mag, b.mag);
+    return {sbignum_make(std::move(q), a.neg != b.neg), sbignum_make(std::move(r), a.neg)};
 }
 
 // Возведение в степень (exp из {1, 2, 3})
@@ -357,49 +965,57 @@ std::pair<BigNum, BigNum> bignum_divmod(const BigNum &a, const BigNum &b) {
 BigNum bignum_pow(const BigNum &base, int exp) {
     if (exp < 1 || exp > 3)
         throw std::invalid_argument("Ошибка: степень должна быть 1, 2 или 3");
-    BigNum result = base;
-    for (int i = 1; i < exp; ++i)
-        result = bignum_mul(result, base); // как сложно
-    return result;
+    if (exp == 1) return base;
+    BigNum sq = bignum_sqr(base);
+    return exp == 2 ? sq : bignum_mul(sq, base); // как сложно
 }
 
 // Целочисленный корень (метод Ньютона)
+// Все временные - в одном кадре арены, размеры известны заранее: приближения
+// не растут (x_0 = 2^ceil(bits/2) > sqrt(a), дальше убывают), частное a/x - около
+// sqrt(a) и по длине не больше x_0, но деление пишет все na - nx + 1 его лимбов,
+// поэтому под него na
 
 BigNum bignum_isqrt(const BigNum &a) {
+    ProfScope prof(ProfKernel::Isqrt);
     if (bignum_is_zero(a)) return zero_bn();
+    size_t na = significant_limbs(a.data(), a.size());
 
-    // Начальное приближение: 2^(ceil(bits/2))
-    // Считаем bits
-    size_t bits = (a.size() - 1) * 32;
-    uint32_t top = a.back();
-    while (top >>= 1) ++bits;
-    ++bits;
+    // Начальное приближение: 2^(ceil(bits/2)), с округлением вверх
+    size_t half_bits = (bignum_bit_length(a) + 1) / 2;
+    size_t nx        = half_bits / 32 + 1;
 
-    // С округлением вверх
-    size_t half_bits = (bits + 1) / 2;
-    // 2^n === 1 << n
-    BigNum x(half_bits / 32 + 1, 0);
-    // В старшем бите нужного лимба
-    x[half_bits / 32] = (1u << (half_bits % 32));
+    ScratchFrame frame;
+    uint32_t *x    = frame.alloc(nx + 1);
+    uint32_t *sum  = frame.alloc(nx + 1);
+    uint32_t *q    = frame.alloc(na);
+    uint32_t *r    = frame.alloc(nx);
+    uint32_t *work = frame.alloc(divmod_scratch_limbs(na, nx));
+    std::fill(x, x + nx, 0);
+    x[half_bits / 32] = 1u << (half_bits % 32);
 
     // Итерация Ньютона: x_new = (x + a/x) / 2
     while (true) {
         // Вычисляем a/x, спасибо крутому делению
-        auto [q, _r] = bignum_divmod(a, x);
-        BigNum sum = bignum_add(x, q);
-        // sum / 2
-        uint64_t carry = 0;
-        for (int i = static_cast<int>(sum.size()) - 1; i >= 0; --i) {
-            uint64_t cur = (carry << 32) | sum[i];
-            sum[i] = static_cast<uint32_t>(cur >> 1);
-            carry = cur & 1;
+        divmod_limbs(a.data(), na, x, nx, q, r, work);
+        size_t nq = significant_limbs(q, na - nx + 1);
+        // (x + a/x) / 2, сложение как в bignum_add: общая часть, потом перенос по длинному
+        const uint32_t *lng = nq > nx ? q : x;
+        size_t          nl  = std::max(nq, nx), nsh = std::min(nq, nx);
+        uint32_t carry = limbs_add_n(sum, x, q, nsh);
+        for (size_t i = nsh; i < nl; ++i) {
+            sum[i] = lng[i] + carry;
+            carry  = carry && sum[i] == 0;
         }
-        normalize(sum);
-        
-        if (bignum_cmp(sum, x) >= 0) break; // сошлось
-        x = sum;
+        sum[nl] = carry;
+        limbs_rshift(sum, sum, nl + 1, 1);
+        size_t ns = significant_limbs(sum, nl + 1);
+
+        if (cmp_limbs(sum, ns, x, nx) >= 0) break; // сошлось
+        std::swap(x, sum);
+        nx = ns;
     }
-    return x;
+    return BigNum(x, x + nx);
 }
 
 // Проверка простоты (деление перебором)
@@ -425,17 +1041,330 @@ bool bignum_is_prime(const BigNum &a) {
     return true;
 }
 
+// НОД (алгоритм Лемера)
+// Шаг Евклида a, b -> b, a mod b - это деление всего числа, хотя частное почти
+// всегда умещается в пару бит и определяется старшими разрядами. Поэтому
+// шаги считаем на старших 64 битах a и b, копя матрицу [[A, B], [C, D]],
+// пока частные по ней гарантированно совпадают с настоящими (условие Коллинза),
+// и применяем её к числам разом: a, b -> A*a + B*b, C*a + D*b.
+// Коэффициенты держим в 32 битах, чтобы комбинация шла циклами addmul/submul
+
+// 64 бита x начиная с бита shift (за концом числа - нули)
+static uint64_t bits_at(const BigNum &x, size_t shift) {
+    size_t   limb = shift / 32, off = shift % 32;
+    uint64_t r    = 0;
+    for (size_t k = 0; k < 3 && limb + k < x.size(); ++k) {
+        unsigned __int128 w = static_cast<unsigned __int128>(x[limb + k]) << (32 * k);
+        r |= static_cast<uint64_t>(w >> off);
+    }
+    return r;
+}
+
+struct LehmerMatrix {
+    int64_t a = 1, b = 0, c = 0, d = 1;
+};
+
+// Накапливает шаги Евклида по старшим битам a >= b. false - ни одного шага
+// сделать не удалось (частное большое), нужен обычный шаг с делением
+static bool lehmer_matrix(const BigNum &a, const BigNum &b, LehmerMatrix &m) {
+    size_t bits  = bignum_bit_length(a);
+    size_t shift = bits > 64 ? bits - 64 : 0;
+    __int128 x = bits_at(a, shift), y = bits_at(b, shift);
+    __int128 A = 1, B = 0, C = 0, D = 1;
+    constexpr __int128 LIMIT = 0xFFFFFFFF;
+    while (y + C != 0 && y + D != 0) {
+        __int128 q = (x + A) / (y + C);
+        if (q != (x + B) / (y + D)) break;
+        __int128 nc = A - q * C, nd = B - q * D;
+        if (nc > LIMIT || nc < -LIMIT || nd > LIMIT || nd < -LIMIT) break;
+        A = C; C = nc;
+        B = D; D = nd;
+        __int128 t = x - q * y;
+        x = y; y = t;
+    }
+    if (B == 0) return false;
+    m = {static_cast<int64_t>(A), static_cast<int64_t>(B), static_cast<int64_t>(C), static_cast<int64_t>(D)};
+    return true;
+}
+
+// x*a + y*b, когда знаки x и y разные (или один из них ноль), а результат
+// заведомо неотрицательный: положительное слагаемое минус отрицательное
+static BigNum lehmer_combine(const BigNum &a, int64_t x, const BigNum &b, int64_t y) {
+    const BigNum &pos  = x > 0 ? a : b;
+    const BigNum &neg  = x > 0 ? b : a;
+    uint32_t      mpos = static_cast<uint32_t>(x > 0 ? x : y);
+    uint32_t      mneg = static_cast<uint32_t>(x > 0 ? -y : -x);
+    BigNum r(pos.size() + 1, 0);
+    r[pos.size()] = limbs_addmul_1(r.data(), pos.data(), pos.size(), mpos);
+    if (mneg != 0) {
+        // |neg| * mneg <= |pos| * mpos, так что neg не длиннее r
+        uint32_t borrow = limbs_submul_1(r.data(), neg.data(), neg.size(), mneg);
+        for (size_t i = neg.size(); borrow && i < r.size(); ++i) {
+            uint32_t prev = r[i];
+            r[i]   = prev - borrow;
+            borrow = prev < borrow;
+        }
+    }
+    normalize(r);
+    return r;
+}
+
+// x*s + y*t для коэффициентов Безу. Коэффициенты соседних шагов Евклида
+// чередуют знак, у x и y знаки тоже разные, так что оба слагаемых одного
+// знака и модули просто складываются
+static SignedBigNum lehmer_combine_signed(const SignedBigNum &s, int64_t x, const SignedBigNum &t, int64_t y) {
+    uint32_t mx = static_cast<uint32_t>(x < 0 ? -x : x);
+    uint32_t my = static_cast<uint32_t>(y < 0 ? -y : y);
+    BigNum   r(std::max(s.mag.size(), t.mag.size()) + 2, 0);
+    auto add_term = [&r](const BigNum &v, uint32_t m) {
+        uint32_t carry = limbs_addmul_1(r.data(), v.data(), v.size(), m);
+        for (size_t i = v.size(); carry; ++i) {
+            uint64_t sum = static_cast<uint64_t>(r[i]) + carry;
+            r[i]  = static_cast<uint32_t>(sum);
+            carry = static_cast<uint32_t>(sum >> 32);
+        }
+    };
+    add_term(s.mag, mx);
+    add_term(t.mag, my);
+    bool neg = (x != 0 && !bignum_is_zero(s.mag)) ? (x < 0) != s.neg : (y < 0) != t.neg;
+    return sbignum_make(std::move(r), neg);
+}
+
+// НОД чисел, уместившихся в 64 бита
+static uint64_t gcd_u64(uint64_t a, uint64_t b) {
+    while (b) {
+        uint64_t t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+static uint64_t to_u64(const BigNum &a) {
+    return a.size() > 1 ? (static_cast<uint64_t>(a[1]) << 32) | a[0] : a[0];
+}
+
+static BigNum from_u64(uint64_t v) {
+    BigNum r = {static_cast<uint32_t>(v), static_cast<uint32_t>(v >> 32)};
+    normalize(r);
+    return r;
+}
+
+BigNum bignum_gcd(const BigNum &a, const BigNum &b) {
+    ProfScope prof(ProfKernel::Gcd);
+    BigNum x = a, y = b;
+    normalize(x); normalize(y);
+    if (bignum_cmp(x, y) < 0) std::swap(x, y);
+    while (!bignum_is_zero(y)) {
+        if (x.size() <= 2) return from_u64(gcd_u64(to_u64(x), to_u64(y)));
+        LehmerMatrix m;
+        if (lehmer_matrix(x, y, m)) {
+            BigNum nx = lehmer_combine(x, m.a, y, m.b);
+            y = lehmer_combine(x, m.c, y, m.d);
+            x = std::move(nx);
+        } else {
+            BigNum r = bignum_divmod(x, y).second;
+            x = std::move(y);
+            y = std::move(r);
+        }
+    }
+    return x;
+}
+
+// Как bignum_gcd, но вместе с числами той же матрицей преобразуются их
+// коэффициенты при первом исходном числе. Второй коэффициент в конце
+// получается точным делением: y = (g - a*x) / b
+BigNumGcdExt bignum_gcdext(const BigNum &a, const BigNum &b) {
+    ProfScope prof(ProfKernel::GcdExt);
+    BigNum u = a, v = b;
+    normalize(u); normalize(v);
+    bool swapped = bignum_cmp(u, v) < 0;
+    if (swapped) std::swap(u, v);
+    const BigNum first = u, second = v;
+
+    SignedBigNum s0 = sbignum_make({1}), s1; // u = s0*first + ..., v = s1*first + ...
+    while (!bignum_is_zero(v)) {
+        LehmerMatrix m;
+        if (u.size() > 2 && lehmer_matrix(u, v, m)) {
+            BigNum nu = lehmer_combine(u, m.a, v, m.b);
+            v = lehmer_combine(u, m.c, v, m.d);
+            u = std::move(nu);
+            SignedBigNum ns = lehmer_combine_signed(s0, m.a, s1, m.b);
+            s1 = lehmer_combine_signed(s0, m.c, s1, m.d);
+            s0 = std::move(ns);
+        } else {
+            auto [q, r] = bignum_divmod(u, v);
+            u = std::move(v);
+            v = std::move(r);
+            SignedBigNum ns = sbignum_sub(s0, sbignum_mul(s1, sbignum_make(std::move(q))));
+            s0 = std::move(s1);
+            s1 = std::move(ns);
+        }
+    }
+
+    BigNumGcdExt res;
+    res.g = u;
+    res.x = s0;
+    if (!bignum_is_zero(second)) {
+        SignedBigNum rest = sbignum_sub(sbignum_make(u), sbignum_mul(sbignum_make(first), s0));
+        res.y = sbignum_divmod(rest, sbignum_make(second)).first;
+    }
+    if (swapped) std::swap(res.x, res.y);
+    return res;
+}
+
+BigNum bignum_modinv(const BigNum &a, const BigNum &m) {
+    if (bignum_is_zero(m))
+        throw std::invalid_argument("Ошибка: модуль равен нулю");
+    if (bignum_cmp(m, one_bn()) == 0) return zero_bn();
+    BigNumGcdExt e = bignum_gcdext(bignum_divmod(a, m).second, m);
+    if (bignum_cmp(e.g, one_bn()) != 0)
+        throw std::invalid_argument("Ошибка: число не взаимно просто с модулем, обратного нет");
+    // |x| < m, так что отрицательный коэффициент приводится одним вычитанием
+    return e.x.neg ? bignum_sub(m, e.x.mag) : e.x.mag;
+}
+
+// Остатки по небольшим модулям
+// a = сумма a[i] * 2^(32i), так что a mod m - сумма лимбов с весами w[i] = 2^(32i) mod m.
+// Лимбы идут блоками по MOD_SMALL_BLOCK: внутри блока веса одни и те же
+// (таблица на модуль), взвешенная сумма блока - limbs_dot (векторно, без
+// переполнения: 256 * 2^32 * 2^24 = 2^64), а блоки склеиваются по модулю с
+// множителем 2^(32 * 256k) mod m. Деление - одно на блок, а не на лимб
+
+static constexpr size_t MOD_SMALL_BLOCK = 256;
+
+// Веса блока для одного модуля и вес следующего блока
+struct ModSmallTable {
+    uint32_t weights[MOD_SMALL_BLOCK];
+    uint64_t step;
+};
+
+// Таблица строится 256 делениями - дольше, чем сам проход по небольшому числу,
+// поэтому таблицы кэшируются (на поток, чтобы без блокировок). Модулей в ходу
+// обычно пара штук, на случай перебора кэш просто сбрасывается
+static const ModSmallTable &mod_small_table(uint32_t m) {
+    thread_local std::unordered_map<uint32_t, ModSmallTable> cache;
+    auto it = cache.find(m);
+    if (it != cache.end()) return it->second;
+    if (cache.size() >= 64) cache.clear();
+    ModSmallTable &t = cache[m];
+    uint64_t base = (1ULL << 32) % m, w = 1 % m;
+    for (size_t j = 0; j < MOD_SMALL_BLOCK; ++j) {
+        t.weights[j] = static_cast<uint32_t>(w);
+        w = w * base % m;
+    }
+    t.step = w;
+    return t;
+}
+
+std::vector<uint32_t> bignum_mod_small(const BigNum &a, const std::vector<uint32_t> &moduli) {
+    ProfScope prof(ProfKernel::ModSmall);
+    for (uint32_t m : moduli)
+        if (m < 2 || m > MOD_SMALL_MAX)
+            throw std::invalid_argument("Ошибка: модуль должен быть от 2 до 2^24");
+    size_t k = moduli.size();
+    std::vector<const ModSmallTable *> tables(k);
+    for (size_t t = 0; t < k; ++t) tables[t] = &mod_small_table(moduli[t]);
+
+    // Блок читается из памяти один раз, по модулям - уже из кэша
+    std::vector<uint64_t> acc(k, 0), pw(k, 1);
+    for (size_t start = 0; start < a.size(); start += MOD_SMALL_BLOCK) {
+        size_t len = std::min(MOD_SMALL_BLOCK, a.size() - start);
+        for (size_t t = 0; t < k; ++t) {
+            uint64_t m   = moduli[t];
+            uint64_t sum = limbs_dot(a.data() + start, tables[t]->weights, len) % m;
+            acc[t] = (acc[t] + sum * pw[t]) % m;
+            pw[t]  = pw[t] * tables[t]->step % m;
+        }
+    }
+    return std::vector<uint32_t>(acc.begin(), acc.end());
+}
+
+uint32_t bignum_mod_small(const BigNum &a, uint32_t m) {
+    return bignum_mod_small(a, std::vector<uint32_t>{m})[0];
+}
+
 // Проверка через исключение девяток
 
 int bignum_digit_root_mod_9(const BigNum &a) {
-    // 2^32 ≡ 4 (mod 9), поэтому
-    // N ≡ a[0]*4^0 + a[1]*4^1 + a[2]*4^2 + ... (mod 9)
-    // Степени 4 по mod 9 циклически: 1, 4, 7, 1, 4, 7, ...  (период 3)
-    static const int pow4mod9[3] = {1, 4, 7};
-    uint64_t sum = 0;
-    for (size_t i = 0; i < a.size(); ++i){
-        sum += static_cast<uint64_t>(a[i]) * pow4mod9[i % 3];
-        sum %= 9;
-    }
-    return static_cast<int>(sum % 9);
+    // 2^32 = 4 (mod 9): веса лимбов 1, 4, 7, 1, 4, 7, ... - частный случай остатка по небольшому модулю
+    return static_cast<int>(bignum_mod_small(a, 9));
+}
+
+// Контрольные остатки
+// Большие модули - схемой Горнера по 64-битным словам от старшего: r = r * 2^64 + w.
+// 2^64 сводится к маленькому числу, так что умножать приходится только
+// на константу: 2^64 = 8 (mod 2^61 - 1), 2^64 = 59 (mod 2^64 - 59), 2^64 = 7 (mod 9).
+// Для 9 ещё 2^24 = 1: слово сводится к сумме своих 24-битных кусков, а остаток -
+// сворачиванием старших бит в младшие, так что % нужен один раз в конце
+
+static uint64_t reduce_m61(unsigned __int128 x) {
+    // 2^61 = 1 (mod M61): старшие биты складываются с младшими
+    while (x >> 61) x = (x & RESIDUE_M61) + (x >> 61);
+    return x == RESIDUE_M61 ? 0 : static_cast<uint64_t>(x);
+}
+
+// x < 2^32 сворачивается до < 2^25, x < 2^29 - тоже (2^24 = 1 mod 9)
+static uint64_t fold_m9(uint64_t x) {
+    return (x & 0xFFFFFF) + (x >> 24);
+}
+
+static uint64_t reduce_p64(unsigned __int128 x) {
+    // 2^64 = 59 (mod P64)
+    while (x >> 64) x = (x >> 64) * 59 + static_cast<uint64_t>(x);
+    uint64_t r = static_cast<uint64_t>(x);
+    return r >= RESIDUE_P64 ? r - RESIDUE_P64 : r;
+}
+
+BigNumResidues bignum_residues(const BigNum &a) {
+    ProfScope prof(ProfKernel::Residues);
+    BigNumResidues r;
+    size_t i = a.size();
+    // Нечётное число лимбов - старший лимб идёт отдельным словом
+    if (i % 2) {
+        --i;
+        r.m9  = fold_m9(a[i]);
+        r.m61 = a[i];
+        r.m64 = a[i];
+    }
+    // В цикле остатки держим не до конца приведёнными (m9 < 2^25, m61 < 2^62, m64 -
+    // любое 64-битное), так на шаг выходит по одному сворачиванию на модуль без ветвлений
+    uint64_t m9 = r.m9, m61 = r.m61, m64 = r.m64;
+    for (; i >= 2; i -= 2) {
+        uint64_t w = (static_cast<uint64_t>(a[i - 1]) << 32) | a[i - 2];
+        // m9 * 7 + три куска слова < 2^28 + 3 * 2^24 < 2^29
+        m9 = fold_m9(m9 * 7 + (w & 0xFFFFFF) + ((w >> 24) & 0xFFFFFF) + (w >> 48));
+        // m61 * 8 + w < 2^65: старшие биты над 61-м - в младшие
+        unsigned __int128 x = static_cast<unsigned __int128>(m61) * 8 + w;
+        m61 = static_cast<uint64_t>((x & RESIDUE_M61) + (x >> 61));
+        // m64 * 59 + w < 2^70: старшее слово * 59 обратно в младшее, перенос - ещё раз
+        unsigned __int128 y = static_cast<unsigned __int128>(m64) * 59 + w;
+        unsigned __int128 z = static_cast<unsigned __int128>(static_cast<uint64_t>(y >> 64)) * 59 + static_cast<uint64_t>(y);
+        m64 = static_cast<uint64_t>(z) + static_cast<uint64_t>(z >> 64) * 59;
+    }
+    r.m9  = m9 % 9;
+    r.m61 = reduce_m61(m61);
+    r.m64 = reduce_p64(m64);
+    return r;
+}
+
+BigNumResidues residues_add(const BigNumResidues &x, const BigNumResidues &y) {
+    return {(x.m9 + y.m9) % 9,
+            reduce_m61(static_cast<unsigned __int128>(x.m61) + y.m61),
+            reduce_p64(static_cast<unsigned __int128>(x.m64) + y.m64)};
+}
+
+BigNumResidues residues_mul(const BigNumResidues &x, const BigNumResidues &y) {
+    return {x.m9 * y.m9 % 9,
+            reduce_m61(static_cast<unsigned __int128>(x.m61) * y.m61),
+            reduce_p64(static_cast<unsigned __int128>(x.m64) * y.m64)};
+}
+
+BigNumResidues residues_pow(const BigNumResidues &x, unsigned exp) {
+    BigNumResidues r{1, 1, 1}, base = x;
+    for (; exp; exp >>= 1) {
+        if (exp & 1) r = residues_mul(r, base);
+        base = residues_mul(base, base);
+    }
+    return r;
 }
@@ -1,28 +1,87 @@
 #pragma once
+#include "alloc.hpp"
+
+#include <atomic>
 #include <cstdint>
+#include <functional>
 #include <string>
+#include <string_view>
 #include <vector>
 
-// Подробности имплементации в bignum.cpp
-using BigNum = std::vector<uint32_t>;
+// Подробности имплементации в bignum.cpp. Большие буферы - через LimbAllocator (alloc.hpp)
+using BigNum = std::vector<uint32_t, LimbAllocator<uint32_t>>;
 
 // -- Конверсия ---------------------------------------------------------------
-BigNum      bignum_from_decimal(const std::string &s);
+BigNum      bignum_from_decimal(std::string_view s);
 std::string bignum_to_decimal(const BigNum &a);
 
+// Приёмник десятичной записи: получает куски цифр строго слева направо
+using DecimalSink = std::function<void(std::string_view)>;
+
+// Потоковая конвертация: цифры отдаются в sink кусками по мере вычисления,
+// так что полная десятичная строка не собирается (например, запись прямо в файл)
+void        bignum_write_decimal(const BigNum &a, const DecimalSink &sink);
+
+// Проверка и разбор за один проход (например, прямо из отображённого в память файла).
+// Возвращает false, если в s не только цифры или есть ведущие нули; out тогда не определён.
+// cancel проверяется между пачками цифр: если он взведён, разбор бросается и тоже false
+bool        bignum_parse_decimal(std::string_view s, BigNum &out,
+                                 const std::atomic<bool> *cancel = nullptr);
+
+// Точное количество десятичных цифр (у нуля - одна) без конвертации. Оценка по
+// длине в битах, при неоднозначности - одно сравнение со степенью десяти из кэша
+// потока (сначала по старшим лимбам), так что повторные вызовы почти бесплатны
+size_t      bignum_decimal_digits(const BigNum &a);
+
+// Первые k десятичных цифр (все, если их меньше k): частное от деления на
+// приближённую 10^(D-k) с контролем погрешности, полной конвертации нет.
+// Быстро для любого размера, кроме чисел с длинными сериями 9 или 0 после k-й цифры
+std::string bignum_leading_digits(const BigNum &a, size_t k);
+
+// Последние k десятичных цифр (с нулями, как в записи числа): a mod 10^k
+std::string bignum_trailing_digits(const BigNum &a, size_t k);
+
+// Десятичные цифры с позиции from (слева, с нуля) в количестве count - без
+// конвертации всего числа: нужный кусок вырезается делением на степени десяти
+std::string bignum_decimal_slice(const BigNum &a, size_t from, size_t count);
+
+// Инкрементальный разбор: value - число из old_digits, после вызова - из new_digits.
+// Изменённый участок строки пересчитывается арифметически (дописывание в конец -
+// умножение на 10^k и сложение, замена цифр в середине - ± delta * 10^pos),
+// так что время зависит от размера правки, а не всего числа.
+// false, если правка слишком большая и дешевле полный bignum_from_decimal (value не тронуто).
+// Обе строки - только цифры, без ведущих нулей
+bool        bignum_update_decimal(BigNum &value, std::string_view old_digits, std::string_view new_digits);
+
 // -- Предикаты ---------------------------------------------------------------
 bool bignum_is_zero(const BigNum &a);
-bool bignum_is_valid_decimal(const std::string &s);  // только цифры, нет ведущих нулей
+bool bignum_is_valid_decimal(std::string_view s);  // только цифры, нет ведущих нулей
 
 // -- Сравнение ----------------------------------------------------------------
 // Возвращает -1, 0, или 1
 int bignum_cmp(const BigNum &a, const BigNum &b);
 
+// -- Биты --------------------------------------------------------------------
+size_t bignum_bit_length(const BigNum &a);  // количество значащих бит, у нуля 0
+size_t bignum_popcount(const BigNum &a);    // количество единичных бит
+size_t bignum_ctz(const BigNum &a);         // младших нулевых бит (a делится на 2^ctz), у нуля 0
+
+BigNum bignum_shl(const BigNum &a, size_t bits);  // a * 2^bits
+BigNum bignum_shr(const BigNum &a, size_t bits);  // a / 2^bits с округлением вниз
+
+BigNum bignum_and(const BigNum &a, const BigNum &b);
+BigNum bignum_or(const BigNum &a, const BigNum &b);
+BigNum bignum_xor(const BigNum &a, const BigNum &b);
+
 // -- Арифметика ---------------------------------------------------------------
 BigNum bignum_add(const BigNum &a, const BigNum &b);
-BigNum bignum_mul(const BigNum &a, const BigNum &b);
+// a - b; throws std::invalid_argument, если a < b (разность со знаком - sbignum_sub)
+BigNum bignum_sub(const BigNum &a, const BigNum &b);
+BigNum bignum_mul(const BigNum &a, const BigNum &b); // на степень двойки - сдвигом
+BigNum bignum_sqr(const BigNum &a);  // a * a, но быстрее bignum_mul(a, a)
 
-// Возвращает {частное, остаток}; throws std::invalid_argument if b == 0
+// Возвращает {частное, остаток}, на степень двойки - сдвигом и маской;
+// throws std::invalid_argument if b == 0
 std::pair<BigNum, BigNum> bignum_divmod(const BigNum &a, const BigNum &b);
 
 // экспонента должна быть 1, 2, или 3; throws std::invalid_argument в ином случае
@@ -31,10 +90,86 @@ BigNum bignum_pow(const BigNum &base, int exp);
 // Целочисленный корень с округлением вниз
 BigNum bignum_isqrt(const BigNum &a);
 
+// -- Числа со знаком ------------------------------------------------------------
+// Знак и модуль отдельно, модуль - обычный BigNum (все операции над ним выше).
+// Ноль всегда без знака: {0}, neg == false
+struct SignedBigNum {
+    BigNum mag = {0};
+    bool   neg = false;
+
+    bool operator==(const SignedBigNum &) const = default;
+};
+
+SignedBigNum sbignum_make(BigNum mag, bool neg = false); // у нуля знак сбрасывается
+// Десятичная запись с необязательным '-' впереди
+SignedBigNum sbignum_from_decimal(std::string_view s);
+std::string  sbignum_to_decimal(const SignedBigNum &a);
+
+int          sbignum_cmp(const SignedBigNum &a, const SignedBigNum &b); // -1, 0, или 1
+SignedBigNum sbignum_neg(const SignedBigNum &a);
+SignedBigNum sbignum_add(const SignedBigNum &a, const SignedBigNum &b);
+SignedBigNum sbignum_sub(const SignedBigNum &a, const SignedBigNum &b);
+SignedBigNum sbignum_mul(const SignedBigNum &a, const SignedBigNum &b);
+
+// Деление с отбрасыванием дробной части, как встроенные / и %: частное
+// округляется к нулю, остаток со знаком делимого (-7 / 2 = -3, -7 % 2 = -1).
+// throws std::invalid_argument if b == 0
+std::pair<SignedBigNum, SignedBigNum> sbignum_divmod(const SignedBigNum &a, const SignedBigNum &b);
+
 // -- Теория чисел --------------------------------------------------------------
 // Проверяет все числа до квадратного корня, что может быть довольно медленно
 bool bignum_is_prime(const BigNum &a);
 
+// Наибольший общий делитель, gcd(a, 0) = a. Алгоритм Лемера: большая часть
+// шагов Евклида делается на старших 64 битах, а по самим числам проходит
+// одна линейная комбинация на пачку шагов вместо деления на каждый
+BigNum bignum_gcd(const BigNum &a, const BigNum &b);
+
+// Расширенный алгоритм Евклида: gcd и коэффициенты Безу, a*x + b*y = g
+struct BigNumGcdExt {
+    BigNum       g;
+    SignedBigNum x;
+    SignedBigNum y;
+};
+BigNumGcdExt bignum_gcdext(const BigNum &a, const BigNum &b);
+
+// Обратный к a по модулю m: 0 <= r < m, a*r mod m == 1 (при m == 1 - ноль).
+// throws std::invalid_argument, если m == 0 или a и m не взаимно просты
+BigNum bignum_modinv(const BigNum &a, const BigNum &m);
+
+// -- Остатки по небольшим модулям -------------------------------------------------
+// a mod m для 2 <= m <= 2^24 без деления на каждом лимбе: взвешенные суммы
+// лимбов копятся векторно в 64 битах, приводятся по модулю раз на 256 лимбов.
+// throws std::invalid_argument, если m вне диапазона
+inline constexpr uint32_t MOD_SMALL_MAX = 1u << 24;
+uint32_t              bignum_mod_small(const BigNum &a, uint32_t m);
+// Сразу по нескольким модулям: число читается из памяти один раз
+std::vector<uint32_t> bignum_mod_small(const BigNum &a, const std::vector<uint32_t> &moduli);
+
 // -- Исключение девяток --------------------------------------------------------
 // Сумма десятичных чисел % 9, но [1; 9] вместо [0; 8], чтобы отличать число 0 от 9*n % 9
 int  bignum_digit_root_mod_9(const BigNum &a);
+
+// -- Контрольные остатки -------------------------------------------------------
+// Остатки числа сразу по нескольким модулям: 9 (то же исключение девяток) и
+// два больших простых. Одна ошибка в лимбе результата меняет все три, а
+// случайно совпасть они могут с вероятностью порядка 2^-125, так что сверка
+// остатков операндов и результата ловит почти любую ошибку за один проход
+inline constexpr uint64_t RESIDUE_M61 = (1ULL << 61) - 1; // простое Мерсенна
+inline constexpr uint64_t RESIDUE_P64 = 0xFFFFFFFFFFFFFFC5ULL; // 2^64 - 59, наибольшее простое в 64 битах
+
+struct BigNumResidues {
+    uint64_t m9  = 0;
+    uint64_t m61 = 0;
+    uint64_t m64 = 0;
+
+    bool operator==(const BigNumResidues &) const = default;
+};
+
+BigNumResidues bignum_residues(const BigNum &a);
+
+// Арифметика над остатками (по каждому модулю отдельно): по ней из остатков
+// операндов получается, какими должны быть остатки результата
+BigNumResidues residues_add(const BigNumResidues &x, const BigNumResidues &y);
+BigNumResidues residues_mul(const BigNumResidues &x, const BigNumResidues &y);
+BigNumResidues residues_pow(const BigNumResidues &x, unsigned exp);
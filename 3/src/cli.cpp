@@ -0,0 +1,373 @@
+#include "cli.hpp"
+#include "bignum.hpp"
+#include "expr.hpp"
+#include "generator.hpp"
+#include "profile.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <format>
+#include <fstream>
+#include <iomanip>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace hrc = std::chrono;
+using Clock   = hrc::steady_clock;
+
+static double ms_since(Clock::time_point t0) {
+    return hrc::duration<double, std::milli>(Clock::now() - t0).count();
+}
+
+static const char *USAGE =
+    "Использование:\n"
+    "  bignums                                   интерактивный режим\n"
+    "  bignums --op OP [--a FILE] [--b FILE] [--exp N] [--expr TEXT]\n"
+    "          [--out FILE] [--format bin|dec]   одна операция\n"
+    "  bignums --batch FILE [--threads N]        задания из файла, по строке на операцию\n"
+    "  --huge-pages (в любом режиме)             большие страницы под числа от 4 МБ\n"
+    "                                            (то же - BIGNUMS_HUGEPAGES=1)\n"
+    "  --profile FILE (в любом режиме)           вызовы, время и память по ядрам и\n"
+    "                                            уровням рекурсии, JSON\n"
+    "  --trace FILE (в любом режиме)             каждый вызов ядра, Chrome trace\n"
+    "                                            (chrome://tracing, ui.perfetto.dev)\n"
+    "\n"
+    "OP: add, sub (A - B, A >= B), mul, div, pow (над A, степень 1-3), prime (A), cmp, gcd, inv (A^-1 mod B), expr (--expr \"(A*B + A^3) mod B\")\n"
+    "Числа читаются из десятичных или .bin файлов. Без --out результат печатается\n"
+    "в stdout десятичным. Формат записи по умолчанию - по расширению --out.\n"
+    "Деление пишет два числа: частное и остаток.\n";
+
+// -----------------------------------------------------------------------
+// Задание
+// -----------------------------------------------------------------------
+
+struct CliJob {
+    std::string op;
+    std::string file_a, file_b, file_out;
+    std::string expr;
+    int         exp = 2;
+    std::optional<NumFormat> format; // пусто - по расширению file_out
+};
+
+// Разбирает параметры одной операции; throws std::invalid_argument
+static CliJob parse_job(const std::vector<std::string> &args) {
+    CliJob job;
+    for (size_t i = 0; i < args.size(); ++i) {
+        const std::string &key = args[i];
+        if (i + 1 >= args.size())
+            throw std::invalid_argument("нет значения для " + key);
+        const std::string &val = args[++i];
+        if      (key == "--op")   job.op       = val;
+        else if (key == "--a")    job.file_a   = val;
+        else if (key == "--b")    job.file_b   = val;
+        else if (key == "--out")  job.file_out = val;
+        else if (key == "--expr") job.expr     = val;
+        else if (key == "--exp") {
+            try { job.exp = std::stoi(val); } catch (...) { throw std::invalid_argument("некорректная степень: " + val); }
+        } else if (key == "--format") {
+            if      (val == "bin") job.format = NumFormat::Binary;
+            else if (val == "dec") job.format = NumFormat::Decimal;
+            else throw std::invalid_argument("формат должен быть bin или dec: " + val);
+        } else {
+            throw std::invalid_argument("неизвестный параметр: " + key);
+        }
+    }
+    static const std::vector<std::string> OPS = {"add", "sub", "mul", "div", "pow", "prime", "cmp", "gcd", "inv", "expr"};
+    if (job.op.empty())
+        throw std::invalid_argument("не указана операция (--op)");
+    if (std::find(OPS.begin(), OPS.end(), job.op) == OPS.end())
+        throw std::invalid_argument("неизвестная операция: " + job.op);
+    if (job.op == "expr" && job.expr.empty())
+        throw std::invalid_argument("для expr нужно --expr");
+    // Результат prime и cmp - текст; в .bin он стал бы файлом, который не загрузить
+    if ((job.op == "prime" || job.op == "cmp") && !job.file_out.empty()
+        && job.format.value_or(format_for_path(job.file_out)) == NumFormat::Binary)
+        throw std::invalid_argument("результат " + job.op + " - текст, в бинарный формат его не записать");
+    return job;
+}
+
+struct JobTimings {
+    double t_load  = 0.0;
+    double t_op    = 0.0;
+    double t_check = 0.0;
+    double t_save  = 0.0;
+};
+
+static BigNum load_operand(const std::string &path, const char *name) {
+    if (path.empty())
+        throw std::invalid_argument(std::string("не указан файл числа ") + name + " (--" + name + ")");
+    return load_bignum_from_file(path);
+}
+
+// Сверка результата по остаткам операндов (см. bignum_residues): один проход
+// по числам, зато ошибка в арифметике не уйдёт в файл молча. throws std::runtime_error
+static void check_result(const CliJob &job, const BigNum &a, const BigNum &b, const std::vector<BigNum> &nums) {
+    BigNumResidues expected, actual;
+    if (job.op == "add" || job.op == "mul") {
+        expected = job.op == "add" ? residues_add(bignum_residues(a), bignum_residues(b))
+                                   : residues_mul(bignum_residues(a), bignum_residues(b));
+        actual   = bignum_residues(nums[0]);
+    } else if (job.op == "sub") {
+        // разность + B = A
+        expected = residues_add(bignum_residues(nums[0]), bignum_residues(b));
+        actual   = bignum_residues(a);
+    } else if (job.op == "div") {
+        if (bignum_cmp(nums[1], b) >= 0)
+            throw std::runtime_error("проверка не прошла: остаток не меньше делителя");
+        expected = residues_add(residues_mul(bignum_residues(nums[0]), bignum_residues(b)), bignum_residues(nums[1]));
+        actual   = bignum_residues(a);
+    } else if (job.op == "pow") {
+        expected = residues_pow(bignum_residues(a), static_cast<unsigned>(job.exp));
+        actual   = bignum_residues(nums[0]);
+    } else {
+        return; // у остальных операций проверки по остаткам нет
+    }
+    if (expected != actual)
+        throw std::runtime_error("проверка по остаткам не прошла: результат " + job.op + " неверный");
+}
+
+// Выполняет задание целиком: загрузка, операция, запись. throws при любой ошибке
+static JobTimings run_job(const CliJob &job) {
+    JobTimings t;
+
+    // Какие числа нужны операции
+    std::optional<ExprGraph> expr;
+    bool need_a = true;
+    bool need_b = !(job.op == "pow" || job.op == "prime");
+    if (job.op == "expr") {
+        expr.emplace(job.expr);
+        need_a = expr->uses_a();
+        need_b = expr->uses_b();
+    }
+
+    auto t0 = Clock::now();
+    BigNum a, b;
+    if (need_a) a = load_operand(job.file_a, "a");
+    if (need_b) b = load_operand(job.file_b, "b");
+    t.t_load = ms_since(t0);
+
+    // Результат - числа либо текст (простота, сравнение)
+    t0 = Clock::now();
+    std::vector<BigNum> nums;
+    std::string         text;
+    if (job.op == "add") {
+        nums.push_back(bignum_add(a, b));
+    } else if (job.op == "sub") {
+        nums.push_back(bignum_sub(a, b));
+    } else if (job.op == "mul") {
+        nums.push_back(a == b ? bignum_sqr(a) : bignum_mul(a, b));
+    } else if (job.op == "div") {
+        auto [q, r] = bignum_divmod(a, b);
+        nums.push_back(std::move(q));
+        nums.push_back(std::move(r));
+    } else if (job.op == "pow") {
+        nums.push_back(bignum_pow(a, job.exp));
+    } else if (job.op == "gcd") {
+        nums.push_back(bignum_gcd(a, b));
+    } else if (job.op == "inv") {
+        nums.push_back(bignum_modinv(a, b));
+    } else if (job.op == "prime") {
+        text = bignum_is_prime(a) ? "простое\n" : "составное\n";
+    } else if (job.op == "cmp") {
+        int c = bignum_cmp(a, b);
+        text  = c < 0 ? "A < B\n" : c > 0 ? "A > B\n" : "A = B\n";
+    } else {
+        nums.push_back(expr->evaluate(a, 0, b, 0));
+    }
+    t.t_op = ms_since(t0);
+
+    t0 = Clock::now();
+    check_result(job, a, b, nums);
+    t.t_check = ms_since(t0);
+
+    t0 = Clock::now();
+    if (job.file_out.empty()) {
+        if (job.format == NumFormat::Binary)
+            throw std::invalid_argument("бинарный формат пишется только в файл (--out)");
+        auto sink = [](std::string_view s) { std::fwrite(s.data(), 1, s.size(), stdout); };
+        for (const auto &n : nums) {
+            bignum_write_decimal(n, sink);
+            sink("\n");
+        }
+        sink(text);
+        std::fflush(stdout);
+    } else {
+        NumFormat fmt = job.format.value_or(format_for_path(job.file_out));
+        if (fmt == NumFormat::Binary) {
+            save_bignum_binary(job.file_out, nums);
+        } else {
+            FileWriter out(job.file_out);
+            for (const auto &n : nums) {
+                out.write_decimal(n);
+                out.write("\n");
+            }
+            out.write(text);
+            out.close();
+        }
+    }
+    t.t_save = ms_since(t0);
+    return t;
+}
+
+static std::string fmt_timings(const JobTimings &t) {
+    return std::format("загрузка {:.3f} мс, операция {:.3f} мс, проверка {:.3f} мс, запись {:.3f} мс",
+                       t.t_load, t.t_op, t.t_check, t.t_save);
+}
+
+// -----------------------------------------------------------------------
+// Пакетный режим
+// -----------------------------------------------------------------------
+
+struct BatchEntry {
+    size_t      line = 0;    // номер строки в файле заданий
+    std::string source;      // сама строка, для отчёта
+    CliJob      job;
+    JobTimings  timings;
+    std::string error;       // пусто - выполнено
+};
+
+static std::vector<std::string> split_words(const std::string &line) {
+    // Кавычки - чтобы в --expr можно было писать пробелы
+    std::vector<std::string> words;
+    std::istringstream in(line);
+    std::string w;
+    while (in >> std::quoted(w)) words.push_back(w);
+    return words;
+}
+
+static int run_batch(const std::string &path, unsigned threads) {
+    std::ifstream f(path);
+    if (!f.is_open())
+        throw std::runtime_error("Не удалось открыть файл заданий: " + path);
+
+    std::vector<BatchEntry> entries;
+    std::string line;
+    for (size_t no = 1; std::getline(f, line); ++no) {
+        std::vector<std::string> words = split_words(line);
+        if (words.empty() || words[0][0] == '#') continue;
+        BatchEntry e;
+        e.line   = no;
+        e.source = line;
+        try { e.job = parse_job(words); } catch (const std::exception &ex) { e.error = ex.what(); }
+        entries.push_back(std::move(e));
+    }
+
+    // Задания раздаются потокам по одному из общего счётчика: длинные не тормозят короткие
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = std::min<unsigned>(threads, std::max<size_t>(1, entries.size()));
+    std::atomic<size_t> next{0};
+    auto worker = [&] {
+        for (size_t i; (i = next++) < entries.size(); ) {
+            BatchEntry &e = entries[i];
+            if (!e.error.empty()) continue;
+            if (e.job.file_out.empty()) {
+                e.error = "в пакетном режиме нужен --out";
+                continue;
+            }
+            try { e.timings = run_job(e.job); } catch (const std::exception &ex) { e.error = ex.what(); }
+        }
+    };
+
+    auto t0 = Clock::now();
+    std::vector<std::thread> pool;
+    for (unsigned i = 0; i < threads; ++i) pool.emplace_back(worker);
+    for (auto &th : pool) th.join();
+    double total = ms_since(t0);
+
+    size_t failed = 0;
+    for (const auto &e : entries) {
+        if (e.error.empty()) {
+            std::printf("строка %zu: %s: %s\n", e.line, e.job.op.c_str(), fmt_timings(e.timings).c_str());
+        } else {
+            ++failed;
+            std::printf("строка %zu: ошибка: %s\n    %s\n", e.line, e.error.c_str(), e.source.c_str());
+        }
+    }
+    std::printf("%s\n", std::format("Заданий: {}, с ошибкой: {}, потоков: {}, всего {:.3f} мс",
+                                     entries.size(), failed, threads, total).c_str());
+    return failed == 0 ? 0 : 1;
+}
+
+// -----------------------------------------------------------------------
+// Общие параметры и профиль
+// -----------------------------------------------------------------------
+
+// Вынимает из args "key VALUE" (пусто, если ключа нет); throws std::invalid_argument
+static std::string take_option(std::vector<std::string> &args, const std::string &key) {
+    auto it = std::find(args.begin(), args.end(), key);
+    if (it == args.end()) return "";
+    if (it + 1 == args.end())
+        throw std::invalid_argument("нет значения для " + key);
+    std::string val = *(it + 1);
+    args.erase(it, it + 2);
+    return val;
+}
+
+static void write_text_file(const std::string &path, const std::string &text) {
+    std::ofstream f(path, std::ios::binary);
+    if (!f || !f.write(text.data(), static_cast<std::streamsize>(text.size())))
+        throw std::runtime_error("не удалось записать " + path);
+}
+
+// -----------------------------------------------------------------------
+
+int run_cli(int argc, char **argv) {
+    std::vector<std::string> args(argv + 1, argv + argc);
+    if (std::find(args.begin(), args.end(), "--help") != args.end()) {
+        std::fputs(USAGE, stdout);
+        return 0;
+    }
+    // Общий для всех режимов флаг, до разбора остального
+    if (auto it = std::find(args.begin(), args.end(), "--huge-pages"); it != args.end()) {
+        bignum_set_huge_pages(true);
+        args.erase(it);
+    }
+    // Ошибки в параметрах - код 2 и подсказка, ошибки выполнения - код 1
+    bool        batch   = false;
+    unsigned    threads = 0;
+    CliJob      job;
+    std::string profile_out, trace_out;
+    try {
+        profile_out = take_option(args, "--profile");
+        trace_out   = take_option(args, "--trace");
+        batch       = !args.empty() && args[0] == "--batch";
+        if (batch) {
+            if (args.size() != 2 && !(args.size() == 4 && args[2] == "--threads"))
+                throw std::invalid_argument("ожидалось: --batch FILE [--threads N]");
+            if (args.size() == 4) {
+                try { threads = static_cast<unsigned>(std::stoul(args[3])); }
+                catch (...) { throw std::invalid_argument("некорректное число потоков: " + args[3]); }
+            }
+        } else {
+            job = parse_job(args);
+        }
+    } catch (const std::exception &ex) {
+        std::fprintf(stderr, "Ошибка: %s\n\n%s", ex.what(), USAGE);
+        return 2;
+    }
+
+    try {
+        if (!profile_out.empty() || !trace_out.empty()) prof_start(!trace_out.empty());
+        int code = 0;
+        if (batch) {
+            code = run_batch(args[1], threads);
+        } else {
+            // Одна операция: время - в stderr, чтобы не мешать результату в stdout
+            JobTimings t = run_job(job);
+            std::fprintf(stderr, "%s\n", fmt_timings(t).c_str());
+        }
+        prof_stop();
+        if (!profile_out.empty()) write_text_file(profile_out, prof_json());
+        if (!trace_out.empty())   write_text_file(trace_out, prof_chrome_trace());
+        return code;
+    } catch (const std::exception &ex) {
+        std::fprintf(stderr, "Ошибка: %s\n", ex.what());
+        return 1;
+    }
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+// Режим командной строки, без интерфейса:
+//   bignums --op mul --a num_a.txt --b num_b.bin --out result.bin [--format bin|dec]
+//   bignums --batch jobs.txt [--threads N]
+// В файле заданий каждая непустая строка (кроме начинающихся с #) - те же
+// параметры, что и для одной операции. Задания выполняются параллельно на всех
+// ядрах, по каждому печатается время загрузки, операции и записи.
+// --profile FILE / --trace FILE - профиль ядер bignum.cpp (profile.hpp) в JSON
+// или в формате Chrome trace, в любом режиме.
+// Возвращает код выхода процесса (0 - всё выполнено)
+int run_cli(int argc, char **argv);
@@ -0,0 +1,280 @@
+#include "expr.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <condition_variable>
+#include <exception>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <tuple>
+
+// Больше - результат всё равно не влезет ни в память, ни в терпение
+static constexpr uint32_t EXPR_MAX_EXP = 1u << 16;
+
+// -----------------------------------------------------------------------
+// Разбор
+// -----------------------------------------------------------------------
+
+// Рекурсивный спуск по грамматике из expr.hpp. Узлы сразу кладутся в граф,
+// повторяющиеся не создаются (хэш-консинг по операции и детям)
+class ExprParser {
+public:
+    ExprParser(ExprGraph &g, std::string_view s) : g_(g), s_(s) {}
+
+    int parse() {
+        skip_spaces();
+        if (pos_ == s_.size()) throw std::invalid_argument("пустое выражение");
+        int root = expr();
+        if (pos_ != s_.size()) fail("лишние символы");
+        return root;
+    }
+
+private:
+    using Op = ExprGraph::Op;
+
+    ExprGraph       &g_;
+    std::string_view s_;
+    size_t           pos_ = 0;
+    // Уже созданные узлы: (операция, левый, правый) -> номер; константы - по цифрам
+    std::map<std::tuple<int, int, int>, int> ops_;
+    std::map<std::string, int>               consts_;
+
+    [[noreturn]] void fail(const std::string &what) const {
+        throw std::invalid_argument("позиция " + std::to_string(pos_ + 1) + ": " + what);
+    }
+
+    void skip_spaces() {
+        while (pos_ < s_.size() && std::isspace(static_cast<unsigned char>(s_[pos_]))) ++pos_;
+    }
+
+    // Съедает токен, если он следующий (слова - без учёта регистра и только целиком)
+    bool accept(std::string_view tok) {
+        if (s_.size() - pos_ < tok.size()) return false;
+        for (size_t i = 0; i < tok.size(); ++i)
+            if (std::tolower(static_cast<unsigned char>(s_[pos_ + i])) != tok[i]) return false;
+        bool word = std::isalpha(static_cast<unsigned char>(tok.back()));
+        if (word && pos_ + tok.size() < s_.size()
+            && std::isalnum(static_cast<unsigned char>(s_[pos_ + tok.size()])))
+            return false;
+        pos_ += tok.size();
+        skip_spaces();
+        return true;
+    }
+
+    std::string number() {
+        size_t start = pos_;
+        while (pos_ < s_.size() && std::isdigit(static_cast<unsigned char>(s_[pos_]))) ++pos_;
+        if (start == pos_) fail("ожидалось число, A, B или '('");
+        // Ведущие нули в выражении не мешают, просто отбрасываем
+        std::string digits(s_.substr(start, pos_ - start));
+        size_t nz = digits.find_first_not_of('0');
+        digits.erase(0, nz == std::string::npos ? digits.size() - 1 : nz);
+        skip_spaces();
+        return digits;
+    }
+
+    int constant(const std::string &digits) {
+        auto it = consts_.find(digits);
+        if (it != consts_.end()) return it->second;
+        int id = g_.add_node(Op::Const, -1, -1, bignum_from_decimal(digits));
+        consts_.emplace(digits, id);
+        return id;
+    }
+
+    int node(Op op, int lhs = -1, int rhs = -1) {
+        // Сложение и умножение коммутативны: A*B и B*A - один узел
+        if ((op == Op::Add || op == Op::Mul) && lhs > rhs) std::swap(lhs, rhs);
+        // Одинаковые множители - квадрат, он почти вдвое дешевле
+        if (op == Op::Mul && lhs == rhs) { op = Op::Sqr; rhs = -1; }
+        auto key = std::make_tuple(static_cast<int>(op), lhs, rhs);
+        auto it  = ops_.find(key);
+        if (it != ops_.end()) return it->second;
+        int id = g_.add_node(op, lhs, rhs);
+        ops_.emplace(key, id);
+        return id;
+    }
+
+    // x^e бинарным возведением: по старшим битам e квадрат, где бит единичный - ещё умножение на x
+    int power_of(int x, uint32_t e) {
+        if (e == 0) return constant("1");
+        int top = 31;
+        while (((e >> top) & 1) == 0) --top;
+        int r = x;
+        for (int bit = top - 1; bit >= 0; --bit) {
+            r = node(Op::Sqr, r);
+            if ((e >> bit) & 1) r = node(Op::Mul, r, x);
+        }
+        return r;
+    }
+
+    int expr() {
+        int lhs = term();
+        while (true) {
+            if      (accept("+")) lhs = node(Op::Add, lhs, term());
+            else if (accept("-")) lhs = node(Op::Sub, lhs, term());
+            else return lhs;
+        }
+    }
+
+    int term() {
+        int lhs = power();
+        while (true) {
+            if      (accept("*"))   lhs = node(Op::Mul, lhs, power());
+            else if (accept("/"))   lhs = node(Op::Div, lhs, power());
+            else if (accept("%") || accept("mod")) lhs = node(Op::Mod, lhs, power());
+            else return lhs;
+        }
+    }
+
+    int power() {
+        int base = atom();
+        if (!accept("^")) return base;
+        std::string e = number();
+        if (e.size() > 6 || std::stoul(e) > EXPR_MAX_EXP)
+            fail("степень больше " + std::to_string(EXPR_MAX_EXP));
+        return power_of(base, static_cast<uint32_t>(std::stoul(e)));
+    }
+
+    int atom() {
+        if (accept("(")) {
+            int inner = expr();
+            if (!accept(")")) fail("ожидалась ')'");
+            return inner;
+        }
+        if (accept("a")) return node(Op::A);
+        if (accept("b")) return node(Op::B);
+        return constant(number());
+    }
+};
+
+ExprGraph::ExprGraph(std::string_view text) : text_(text) {
+    root_ = ExprParser(*this, text_).parse();
+}
+
+int ExprGraph::add_node(Op op, int lhs, int rhs, BigNum value) {
+    Node n;
+    n.op    = op;
+    n.lhs   = lhs;
+    n.rhs   = rhs;
+    n.value = std::move(value);
+    n.valid = (op == Op::Const);
+    if (op == Op::A) n.deps = 1;
+    if (op == Op::B) n.deps = 2;
+    if (lhs >= 0) n.deps |= nodes_[lhs].deps;
+    if (rhs >= 0) n.deps |= nodes_[rhs].deps;
+    nodes_.push_back(std::move(n));
+    return static_cast<int>(nodes_.size()) - 1;
+}
+
+bool ExprGraph::uses_a() const { return nodes_[root_].deps & 1; }
+bool ExprGraph::uses_b() const { return nodes_[root_].deps & 2; }
+
+// -----------------------------------------------------------------------
+// Вычисление
+// -----------------------------------------------------------------------
+
+BigNum ExprGraph::compute(int i, const BigNum &a, const BigNum &b) const {
+    const Node &n = nodes_[i];
+    auto arg = [&](int j) -> const BigNum & {
+        const Node &c = nodes_[j];
+        return c.op == Op::A ? a : c.op == Op::B ? b : c.value;
+    };
+    switch (n.op) {
+        case Op::Add: return bignum_add(arg(n.lhs), arg(n.rhs));
+        case Op::Sub: return bignum_sub(arg(n.lhs), arg(n.rhs));
+        case Op::Mul: return bignum_mul(arg(n.lhs), arg(n.rhs));
+        case Op::Sqr: return bignum_sqr(arg(n.lhs));
+        case Op::Div: return bignum_divmod(arg(n.lhs), arg(n.rhs)).first;
+        case Op::Mod: return bignum_divmod(arg(n.lhs), arg(n.rhs)).second;
+        default:      return arg(i); // листья
+    }
+}
+
+BigNum ExprGraph::evaluate(const BigNum &a, uint64_t version_a,
+                           const BigNum &b, uint64_t version_b, Stats *stats) {
+    // Узел считается заново, если кэша нет или поменялось число, от которого он зависит.
+    // Листья (A, B, константы) не считаются вовсе
+    size_t n = nodes_.size();
+    std::vector<bool> todo(n, false);
+    size_t computed = 0, reused = 0;
+    for (size_t i = 0; i < n; ++i) {
+        const Node &nd = nodes_[i];
+        if (nd.op == Op::A || nd.op == Op::B || nd.op == Op::Const) continue;
+        bool fresh = nd.valid
+                  && (!(nd.deps & 1) || nd.version_a == version_a)
+                  && (!(nd.deps & 2) || nd.version_b == version_b);
+        todo[i] = !fresh;
+        ++(fresh ? reused : computed);
+    }
+    if (stats) *stats = {computed, reused};
+
+    // Планировщик: у каждого узла счётчик ещё не готовых детей; узел с нулём
+    // попадает в очередь готовых и его забирает свободный поток.
+    // Ребро считается столько раз, сколько встречается (у A/A оба ребра - в один узел)
+    std::vector<int>              pending(n, 0);
+    std::vector<std::vector<int>> parents(n);
+    std::vector<int>              ready;
+    for (size_t i = 0; i < n; ++i) {
+        if (!todo[i]) continue;
+        for (int c : {nodes_[i].lhs, nodes_[i].rhs}) {
+            if (c < 0 || !todo[c]) continue;
+            ++pending[i];
+            parents[c].push_back(static_cast<int>(i));
+        }
+        if (pending[i] == 0) ready.push_back(static_cast<int>(i));
+    }
+
+    std::mutex              mtx;
+    std::condition_variable cv;
+    size_t                  remaining = computed;
+    std::exception_ptr      error;
+
+    auto worker = [&] {
+        std::unique_lock<std::mutex> lock(mtx);
+        while (true) {
+            cv.wait(lock, [&] { return !ready.empty() || remaining == 0 || error; });
+            if (remaining == 0 || error) return;
+            int i = ready.back();
+            ready.pop_back();
+            lock.unlock();
+
+            // Дети уже посчитаны и до конца вычисления не меняются, так что читаем без блокировки
+            BigNum value;
+            try {
+                value = compute(i, a, b);
+            } catch (...) {
+                lock.lock();
+                if (!error) error = std::current_exception();
+                cv.notify_all();
+                return;
+            }
+
+            lock.lock();
+            Node &nd     = nodes_[i];
+            nd.value     = std::move(value);
+            nd.valid     = true;
+            nd.version_a = version_a;
+            nd.version_b = version_b;
+            --remaining;
+            for (int p : parents[i])
+                if (--pending[p] == 0) ready.push_back(p);
+            cv.notify_all();
+        }
+    };
+
+    // Потоков не больше, чем узлов для пересчёта; один узел считаем прямо здесь
+    size_t threads = std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()), computed);
+    if (threads > 1) {
+        std::vector<std::thread> pool;
+        for (size_t t = 0; t < threads; ++t) pool.emplace_back(worker);
+        for (auto &th : pool) th.join();
+    } else if (computed > 0) {
+        worker();
+    }
+    if (error) std::rethrow_exception(error);
+
+    const Node &root = nodes_[root_];
+    return root.op == Op::A ? a : root.op == Op::B ? b : root.value;
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include "bignum.hpp"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Выражение над числами A и B, например "(A*B + A^3) mod B".
+//
+// Грамматика (пробелы игнорируются, A/B и mod - в любом регистре):
+//   expr  := term { ('+' | '-') term }
+//   term  := power { ('*' | '/' | '%' | 'mod') power }
+//   power := atom [ '^' число ]
+//   atom  := 'A' | 'B' | число | '(' expr ')'
+// '/' - частное, '%' и mod - остаток, разность не может быть отрицательной.
+//
+// Выражение разбирается в граф (DAG): одинаковые подвыражения - один узел
+// (A*B и B*A тоже), x*x - возведение в квадрат, x^n раскрывается в цепочку
+// квадратов и умножений. Значение каждого узла кэшируется вместе с версиями
+// A и B, от которых оно посчитано, так что после правки одного числа
+// пересчитываются только зависящие от него узлы
+class ExprGraph {
+public:
+    // throws std::invalid_argument с позицией ошибки
+    explicit ExprGraph(std::string_view text);
+
+    const std::string &text() const { return text_; }
+    bool   uses_a()     const;
+    bool   uses_b()     const;
+    size_t node_count() const { return nodes_.size(); }
+
+    struct Stats {
+        size_t computed = 0; // узлов посчитано заново
+        size_t reused   = 0; // узлов взято из кэша
+    };
+
+    // Значение выражения. version_a/version_b - версии чисел: узел берётся из
+    // кэша, если числа, от которых он зависит, с прошлого раза не менялись.
+    // Независимые ветви считаются параллельно: на время вызова запускается до
+    // hardware_concurrency() потоков (не больше, чем узлов для пересчёта).
+    // throws std::invalid_argument при делении на ноль и отрицательной разности
+    BigNum evaluate(const BigNum &a, uint64_t version_a,
+                    const BigNum &b, uint64_t version_b, Stats *stats = nullptr);
+
+private:
+    enum class Op { A, B, Const, Add, Sub, Mul, Sqr, Div, Mod };
+
+    struct Node {
+        Op       op;
+        int      lhs  = -1;
+        int      rhs  = -1;
+        unsigned deps = 0;  // от каких чисел зависит: бит 0 - A, бит 1 - B
+        // Кэш значения (у констант - сама константа, у A и B не используется)
+        BigNum   value;
+        bool     valid     = false;
+        uint64_t version_a = 0;
+        uint64_t version_b = 0;
+    };
+
+    std::string       text_;
+    std::vector<Node> nodes_;
+    int               root_ = -1;
+
+    friend class ExprParser;
+    int    add_node(Op op, int lhs, int rhs, BigNum value = {});
+    BigNum compute(int i, const BigNum &a, const BigNum &b) const;
+};
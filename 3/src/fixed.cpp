@@ -0,0 +1,100 @@
+#include "fixed.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <type_traits>
+
+bool bignum_fixed_enabled() {
+    static const bool on = [] {
+        const char *env = std::getenv("BIGNUMS_FIXED");
+        return !(env && (std::strcmp(env, "off") == 0 || std::strcmp(env, "0") == 0));
+    }();
+    return on;
+}
+
+// ----------------------------------------------------------------------------
+// Выбор ширины: наименьшая из FIXED_WIDTHS, куда помещается число, и вызов
+// версии для неё. Каждая ширина - отдельный экземпляр шаблона со своими
+// циклами, так что switch здесь - вся цена перехода
+// ----------------------------------------------------------------------------
+
+namespace {
+
+// Ширина в битах для числа из limbs лимбов, 0 - больше самой широкой
+size_t width_for(size_t limbs) {
+    for (size_t w : FIXED_WIDTHS)
+        if (limbs <= w / 32) return w;
+    return 0;
+}
+
+// f(std::integral_constant<size_t, W>) для ширины bits
+template <class F>
+bool with_width(size_t bits, F &&f) {
+    switch (bits) {
+        case 256:  return f(std::integral_constant<size_t, 256>{});
+        case 512:  return f(std::integral_constant<size_t, 512>{});
+        case 1024: return f(std::integral_constant<size_t, 1024>{});
+        case 2048: return f(std::integral_constant<size_t, 2048>{});
+        case 4096: return f(std::integral_constant<size_t, 4096>{});
+        case 8192: return f(std::integral_constant<size_t, 8192>{});
+        default:   return false;
+    }
+}
+
+template <size_t Bits>
+FixedBigNum<Bits> load(const BigNum &a) {
+    return FixedBigNum<Bits>::from_limbs(a.data(), a.size());
+}
+
+} // namespace
+
+// ----------------------------------------------------------------------------
+// Переходы из bignum.cpp
+// ----------------------------------------------------------------------------
+
+bool fixed_try_mul(const BigNum &a, const BigNum &b, BigNum &r) {
+    if (!bignum_fixed_enabled()) return false;
+    size_t n = std::max(a.size(), b.size());
+    size_t w = width_for(n);
+    // Оба больше половины ширины: иначе короткий множитель дополнялся бы нулями зря
+    if (w == 0 || std::min(a.size(), b.size()) <= w / 64) return false;
+    return with_width(w, [&](auto bits) {
+        constexpr size_t B = decltype(bits)::value;
+        r = fixed_mul(load<B>(a), load<B>(b)).to_bignum();
+        return true;
+    });
+}
+
+bool fixed_try_sqr(const BigNum &a, BigNum &r) {
+    if (!bignum_fixed_enabled()) return false;
+    size_t w = width_for(a.size());
+    if (w == 0 || a.size() <= w / 64) return false;
+    return with_width(w, [&](auto bits) {
+        constexpr size_t B = decltype(bits)::value;
+        r = fixed_sqr(load<B>(a)).to_bignum();
+        return true;
+    });
+}
+
+// Делитель - ширины W без пустого старшего слова, делимое - больше 1.5W и до 2W
+// бит (остаток произведения, a*b mod m). При делимом поуже пустые старшие слова
+// стоили бы лишних проходов по делителю, а при делимом ширины W частное - одно
+// слово, и перекладывание чисел в FixedBigNum и обратно дороже самого деления
+bool fixed_try_divmod(const BigNum &a, const BigNum &b, BigNum &q, BigNum &r) {
+    if (!bignum_fixed_enabled()) return false;
+    size_t nb = b.size(), na = a.size();
+    size_t w  = width_for(nb);
+    if (w == 0 || nb + 1 < w / 32) return false;
+    size_t limbs = w / 32;
+    if (na > 2 * limbs || 2 * na <= 3 * limbs) return false;
+    return with_width(w, [&](auto bits) {
+        constexpr size_t B = decltype(bits)::value;
+        FixedBigNum<2 * B> fq;
+        FixedBigNum<B>     fr;
+        fixed_divmod(load<2 * B>(a), load<B>(b), fq, fr);
+        q = fq.to_bignum();
+        r = fr.to_bignum();
+        return true;
+    });
+}
@@ -0,0 +1,284 @@
+#pragma once
+#include "bignum.hpp"
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+// Числа фиксированной ширины: Bits бит в std::array из 64-битных слов (little-endian).
+// Количество слов известно при компиляции, поэтому у циклов нет проверок длины,
+// числа живут на стеке, а компилятор разворачивает циклы целиком (сложение) или
+// пачками (умножение и деление - квадратичные, полная развёртка на 8192 битах
+// заняла бы сотни килобайт кода). Умножение - 64x64 бита за шаг, вдвое меньше
+// умножений, чем у циклов из limbs.cpp (там 64x32).
+// bignum_mul/sqr/divmod сами переходят на эти версии, если операнды попадают в
+// одну из ширин FIXED_WIDTHS (см. fixed_try_* ниже); fixed_powmod собран из них
+// и вызывается напрямую. Сложение и вычитание - нет:
+// они линейные, и перекладывание лимбов в FixedBigNum и обратно стоит дороже их самих
+
+template <size_t Bits>
+struct FixedBigNum {
+    static_assert(Bits % 64 == 0 && Bits > 0, "ширина - целое число 64-битных слов");
+    static constexpr size_t WORDS = Bits / 64;
+    static constexpr size_t LIMBS = Bits / 32;
+
+    std::array<uint64_t, WORDS> w{};
+
+    // Из n лимбов (n <= LIMBS), недостающие старшие - нули. На little-endian
+    // пара лимбов и есть слово, так что это просто копирование
+    static FixedBigNum from_limbs(const uint32_t *a, size_t n) {
+        FixedBigNum r;
+        if constexpr (std::endian::native == std::endian::little) {
+            std::memcpy(r.w.data(), a, n * sizeof(uint32_t));
+        } else {
+            for (size_t i = 0; i < n; ++i) r.w[i / 2] |= static_cast<uint64_t>(a[i]) << (32 * (i % 2));
+        }
+        return r;
+    }
+
+    // throws std::invalid_argument, если a не помещается в Bits бит
+    static FixedBigNum from_bignum(const BigNum &a) {
+        size_t n = a.size();
+        while (n > 1 && a[n - 1] == 0) --n;
+        if (n > LIMBS) throw std::invalid_argument("Ошибка: число не помещается в фиксированную ширину");
+        return from_limbs(a.data(), n);
+    }
+
+    // Младшие n лимбов (n <= LIMBS)
+    void to_limbs(uint32_t *r, size_t n = LIMBS) const {
+        if constexpr (std::endian::native == std::endian::little) {
+            std::memcpy(r, w.data(), n * sizeof(uint32_t));
+        } else {
+            for (size_t i = 0; i < n; ++i) r[i] = static_cast<uint32_t>(w[i / 2] >> (32 * (i % 2)));
+        }
+    }
+
+    // Без ведущих нулей, как все BigNum
+    BigNum to_bignum() const {
+        size_t words = WORDS;
+        while (words > 1 && w[words - 1] == 0) --words;
+        size_t n = 2 * words - (w[words - 1] >> 32 == 0 ? 1 : 0);
+        BigNum r(n);
+        to_limbs(r.data(), n);
+        return r;
+    }
+
+    bool operator==(const FixedBigNum &) const = default;
+};
+
+// -- Арифметика --------------------------------------------------------------
+// Результат - по модулю 2^Bits, выходящий перенос или заём возвращается
+
+template <size_t Bits>
+uint64_t fixed_add(FixedBigNum<Bits> &r, const FixedBigNum<Bits> &a, const FixedBigNum<Bits> &b) {
+    uint64_t carry = 0;
+#pragma GCC unroll 128
+    for (size_t i = 0; i < FixedBigNum<Bits>::WORDS; ++i) {
+        unsigned __int128 s = static_cast<unsigned __int128>(a.w[i]) + b.w[i] + carry;
+        r.w[i] = static_cast<uint64_t>(s);
+        carry  = static_cast<uint64_t>(s >> 64);
+    }
+    return carry;
+}
+
+template <size_t Bits>
+uint64_t fixed_sub(FixedBigNum<Bits> &r, const FixedBigNum<Bits> &a, const FixedBigNum<Bits> &b) {
+    uint64_t borrow = 0;
+#pragma GCC unroll 128
+    for (size_t i = 0; i < FixedBigNum<Bits>::WORDS; ++i) {
+        unsigned __int128 d = static_cast<unsigned __int128>(a.w[i]) - b.w[i] - borrow;
+        r.w[i] = static_cast<uint64_t>(d);
+        borrow = static_cast<uint64_t>(d >> 64) & 1; // ушли в минус - старшие биты взведены
+    }
+    return borrow;
+}
+
+// Полное произведение в столбик, по строке на слово a
+template <size_t Bits>
+FixedBigNum<2 * Bits> fixed_mul(const FixedBigNum<Bits> &a, const FixedBigNum<Bits> &b) {
+    constexpr size_t N = FixedBigNum<Bits>::WORDS;
+    FixedBigNum<2 * Bits> r;
+    for (size_t i = 0; i < N; ++i) {
+        uint64_t carry = 0;
+        // (2^64-1)^2 + 2*(2^64-1) = 2^128-1, переполнения нет
+#pragma GCC unroll 8
+        for (size_t j = 0; j < N; ++j) {
+            unsigned __int128 cur = static_cast<unsigned __int128>(a.w[i]) * b.w[j] + r.w[i + j] + carry;
+            r.w[i + j] = static_cast<uint64_t>(cur);
+            carry      = static_cast<uint64_t>(cur >> 64);
+        }
+        r.w[i + N] = carry;
+    }
+    return r;
+}
+
+// Квадрат как bignum_sqr: половина произведений выше диагонали, удвоение, диагональ
+template <size_t Bits>
+FixedBigNum<2 * Bits> fixed_sqr(const FixedBigNum<Bits> &a) {
+    constexpr size_t N = FixedBigNum<Bits>::WORDS;
+    FixedBigNum<2 * Bits> r;
+    for (size_t i = 0; i + 1 < N; ++i) {
+        uint64_t carry = 0;
+#pragma GCC unroll 8
+        for (size_t j = i + 1; j < N; ++j) {
+            unsigned __int128 cur = static_cast<unsigned __int128>(a.w[i]) * a.w[j] + r.w[i + j] + carry;
+            r.w[i + j] = static_cast<uint64_t>(cur);
+            carry      = static_cast<uint64_t>(cur >> 64);
+        }
+        r.w[i + N] = carry;
+    }
+    // Удваиваем: сдвиг на бит влево сверху вниз
+    for (size_t i = 2 * N - 1; i > 0; --i) r.w[i] = (r.w[i] << 1) | (r.w[i - 1] >> 63);
+    r.w[0] <<= 1;
+    uint64_t carry = 0;
+    for (size_t i = 0; i < N; ++i) {
+        unsigned __int128 p  = static_cast<unsigned __int128>(a.w[i]) * a.w[i];
+        unsigned __int128 lo = static_cast<unsigned __int128>(r.w[2 * i]) + static_cast<uint64_t>(p) + carry;
+        r.w[2 * i] = static_cast<uint64_t>(lo);
+        unsigned __int128 hi = static_cast<unsigned __int128>(r.w[2 * i + 1]) + static_cast<uint64_t>(p >> 64)
+                               + static_cast<uint64_t>(lo >> 64);
+        r.w[2 * i + 1] = static_cast<uint64_t>(hi);
+        carry = static_cast<uint64_t>(hi >> 64);
+    }
+    return r;
+}
+
+// (hi * 2^64 + lo) / d, hi < d. На x86-64 - одна инструкция div, иначе
+// компилятор зовёт общее деление 128-битных чисел из libgcc, заметно медленнее
+inline void div_128_64(uint64_t hi, uint64_t lo, uint64_t d, uint64_t &q, uint64_t &r) {
+#if defined(__x86_64__) && defined(__GNUC__)
+    asm("divq %4" : "=a"(q), "=d"(r) : "a"(lo), "d"(hi), "rm"(d));
+#else
+    unsigned __int128 num = (static_cast<unsigned __int128>(hi) << 64) | lo;
+    q = static_cast<uint64_t>(num / d);
+    r = static_cast<uint64_t>(num % d);
+#endif
+}
+
+// Деление (алгоритм D Кнута, как divmod_limbs в bignum.cpp, но по 64-битным словам:
+// оценка частного - деление 128 бит на 64). Делитель полной ширины: старшее
+// слово b не ноль, иначе std::invalid_argument. q - всё частное, r - остаток
+template <size_t ABits, size_t BBits>
+void fixed_divmod(const FixedBigNum<ABits> &a, const FixedBigNum<BBits> &b,
+                  FixedBigNum<ABits> &q, FixedBigNum<BBits> &r) {
+    static_assert(ABits >= BBits, "делимое не уже делителя");
+    constexpr size_t NA = FixedBigNum<ABits>::WORDS;
+    constexpr size_t N  = FixedBigNum<BBits>::WORDS;
+    constexpr size_t M  = NA - N;
+    if (b.w[N - 1] == 0)
+        throw std::invalid_argument("Ошибка: делитель неполной ширины");
+
+    // Нормализация: сдвиг, после которого у делителя взведён старший бит
+    unsigned shift = static_cast<unsigned>(std::countl_zero(b.w[N - 1]));
+    std::array<uint64_t, NA + 1> u;
+    std::array<uint64_t, N>      v;
+    if (shift > 0) {
+        u[NA] = a.w[NA - 1] >> (64 - shift);
+        for (size_t i = NA - 1; i > 0; --i) u[i] = (a.w[i] << shift) | (a.w[i - 1] >> (64 - shift));
+        u[0] = a.w[0] << shift;
+        for (size_t i = N - 1; i > 0; --i) v[i] = (b.w[i] << shift) | (b.w[i - 1] >> (64 - shift));
+        v[0] = b.w[0] << shift;
+    } else {
+        for (size_t i = 0; i < NA; ++i) u[i] = a.w[i];
+        u[NA] = 0;
+        v = b.w;
+    }
+
+    const uint64_t vn1 = v[N - 1], vn2 = v[N - 2];
+    q = {};
+    for (size_t j = M + 1; j-- > 0;) {
+        unsigned __int128 qhat, rhat;
+        if (u[j + N] >= vn1) { // u[j + N] == vn1, частное упирается в максимум слова
+            qhat = UINT64_MAX;
+            rhat = static_cast<unsigned __int128>(u[j + N - 1]) + vn1;
+        } else {
+            uint64_t qq, rr;
+            div_128_64(u[j + N], u[j + N - 1], vn1, qq, rr);
+            qhat = qq;
+            rhat = rr;
+        }
+        while (rhat <= UINT64_MAX && qhat * vn2 > ((rhat << 64) | u[j + N - 2])) {
+            --qhat;
+            rhat += vn1;
+        }
+
+        // u[j..j+N] -= qhat * v (qhat уже в одном слове - умножение 64x64)
+        const uint64_t qd     = static_cast<uint64_t>(qhat);
+        uint64_t       borrow = 0;
+#pragma GCC unroll 8
+        for (size_t i = 0; i < N; ++i) {
+            unsigned __int128 p  = static_cast<unsigned __int128>(qd) * v[i] + borrow;
+            uint64_t          lo = static_cast<uint64_t>(p);
+            uint64_t          ui = u[j + i];
+            u[j + i] = ui - lo;
+            borrow   = static_cast<uint64_t>(p >> 64) + (ui < lo);
+        }
+        bool negative = borrow > u[j + N];
+        u[j + N] -= borrow;
+        q.w[j] = qd;
+
+        // qhat оказался на единицу больше - возвращаем делитель
+        if (negative) {
+            --q.w[j];
+            uint64_t carry = 0;
+            for (size_t i = 0; i < N; ++i) {
+                unsigned __int128 s = static_cast<unsigned __int128>(u[j + i]) + v[i] + carry;
+                u[j + i] = static_cast<uint64_t>(s);
+                carry    = static_cast<uint64_t>(s >> 64);
+            }
+            u[j + N] += carry;
+        }
+    }
+
+    if (shift > 0) {
+        for (size_t i = 0; i + 1 < N; ++i) r.w[i] = (u[i] >> shift) | (u[i + 1] << (64 - shift));
+        r.w[N - 1] = u[N - 1] >> shift;
+    } else {
+        for (size_t i = 0; i < N; ++i) r.w[i] = u[i];
+    }
+}
+
+// base^exp mod m, слева направо по битам exp: квадрат и деление на каждом бите,
+// умножение на взведённых. Всё на стеке, произведение вдвое шире m - ровно тот
+// случай, под который написан fixed_divmod. Требования к m - как у делителя там
+template <size_t Bits, size_t EBits>
+FixedBigNum<Bits> fixed_powmod(const FixedBigNum<Bits> &base, const FixedBigNum<EBits> &exp,
+                               const FixedBigNum<Bits> &m) {
+    FixedBigNum<2 * Bits> q, wide;
+    FixedBigNum<Bits>     b, r;
+    // Основание приводим по модулю: оно может быть и не меньше m
+    for (size_t i = 0; i < FixedBigNum<Bits>::WORDS; ++i) wide.w[i] = base.w[i];
+    fixed_divmod(wide, m, q, b);
+    // m полной ширины, то есть заведомо больше 1: начинаем с r = 1 и пропускаем
+    // ведущие нули показателя, пока r не отличается от единицы
+    r.w[0]       = 1;
+    bool started = false;
+    for (size_t i = FixedBigNum<EBits>::WORDS; i-- > 0;) {
+        for (int bit = 63; bit >= 0; --bit) {
+            if (started) fixed_divmod(fixed_sqr(r), m, q, r);
+            if ((exp.w[i] >> bit) & 1) {
+                fixed_divmod(fixed_mul(r, b), m, q, r);
+                started = true;
+            }
+        }
+    }
+    return r;
+}
+
+// -- Автоматический выбор ------------------------------------------------------
+// Ширины, для которых есть готовые версии. Операнды умножения подходят к ширине W,
+// если в каждом больше W/2 и до W бит (недостающие слова - нули); у деления
+// делитель почти ровно W бит (старшее 64-битное слово не пустое), делимое - больше
+// 1.5W и до 2W. Переменная окружения BIGNUMS_FIXED=off выключает переход (например, для сравнения)
+inline constexpr size_t FIXED_WIDTHS[] = {256, 512, 1024, 2048, 4096, 8192};
+
+bool bignum_fixed_enabled();
+
+// true - посчитано фиксированной версией (результат нормализован), false - не подошло,
+// считать общим путём. Операнды нормализованы, ненулевые
+bool fixed_try_mul(const BigNum &a, const BigNum &b, BigNum &r);
+bool fixed_try_sqr(const BigNum &a, BigNum &r);
+bool fixed_try_divmod(const BigNum &a, const BigNum &b, BigNum &q, BigNum &r); // a > b
@@ -1,20 +1,22 @@
 #include "generator.hpp"
 #include "bignum.hpp"
 
-#include <fstream>
-#include <thread>
+#include <bit>
+#include <cerrno>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string_view>
 
+#include <fcntl.h>
 #include <gmp.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
 
 // RAII-обёртки
-struct GmpRand {
-    gmp_randstate_t state;
-    GmpRand()  { gmp_randinit_mt(state); }
-    ~GmpRand() { gmp_randclear(state); }
-    GmpRand(const GmpRand&)            = delete;
-    GmpRand& operator=(const GmpRand&) = delete;
-};
-
 struct Mpz {
     mpz_t val;
     Mpz()  { mpz_init(val); }
@@ -23,53 +25,359 @@ struct Mpz {
     Mpz& operator=(const Mpz&) = delete;
 };
 
-void generate_and_save(const std::string &path,
-                       unsigned int size_bytes) {
-    GmpRand rng;
+// Файл, отображённый в память только для чтения
+struct MappedFile {
+    const char *data = nullptr;
+    size_t      size = 0;
 
-    // Используем время + хэш thread id для разного зерна при каждом вызове
-    unsigned long seed = static_cast<unsigned long>(std::time(nullptr))
-                       ^ static_cast<unsigned long>(
-                             std::hash<std::thread::id>{}(
-                                 std::this_thread::get_id()));
-    gmp_randseed_ui(rng.state, seed);
+    explicit MappedFile(const std::string &path) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            throw std::runtime_error("Не удалось открыть файл: " + path);
+        struct stat sb{};
+        if (::fstat(fd, &sb) != 0) {
+            ::close(fd);
+            throw std::runtime_error("Не удалось прочитать файл: " + path);
+        }
+        size = static_cast<size_t>(sb.st_size);
+        if (size > 0) { // mmap нулевой длины - ошибка, пустой файл обработает вызывающий
+            void *p = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p == MAP_FAILED) {
+                ::close(fd);
+                throw std::runtime_error("Не удалось отобразить файл в память: " + path);
+            }
+            ::madvise(p, size, MADV_SEQUENTIAL); // читаем один раз от начала до конца
+            data = static_cast<const char *>(p);
+        }
+        ::close(fd); // отображение живёт и без дескриптора
+    }
+    ~MappedFile() {
+        if (data) ::munmap(const_cast<char *>(data), size);
+    }
+    MappedFile(const MappedFile&)            = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
 
-    Mpz n;
+    std::string_view view() const { return {data, size}; }
+};
 
-    unsigned int bits = size_bytes * 8;
-    if (bits < 8) bits = 8; // минимум 1 байт
+/**
+ * БИНАРНЫЙ ФОРМАТ (.bin), версия 1
+ *
+ * Файл - одна или несколько записей подряд (например, частное и остаток).
+ * Запись = заголовок BinHeader (24 байта) + limb_count лимбов по limb_bits бит,
+ * little-endian, младший лимб первым - ровно как BigNum лежит в памяти.
+ * Поэтому загрузка - это проверка заголовка, контрольной суммы и один memcpy
+ * из отображённого файла; никакой десятичной конвертации.
+ *
+ * Контрольная сумма - Fletcher-64 по 32-битным лимбам: две суммы по модулю
+ * 2^32-1, считается за один проход со скоростью чтения памяти.
+ */
+static_assert(std::endian::native == std::endian::little,
+              "бинарный формат пишется как есть, нужна little-endian платформа");
+
+struct BinHeader {
+    char     magic[4];    // "BGNM"
+    uint16_t version;     // BIN_VERSION
+    uint16_t limb_bits;   // 32
+    uint64_t limb_count;  // > 0
+    uint64_t checksum;    // fletcher64 по лимбам
+};
+static_assert(sizeof(BinHeader) == 24, "заголовок не должен зависеть от выравнивания");
 
-    // Генерируем случайное число заданного размера и устанавливаем старший бит
-    mpz_urandomb(n.val, rng.state, bits);
-    mpz_setbit(n.val, bits - 1); // точный размер
+static constexpr char     BIN_MAGIC[4] = {'B', 'G', 'N', 'M'};
+static constexpr uint16_t BIN_VERSION  = 1;
 
+static uint64_t fletcher64(const uint32_t *w, size_t n) {
+    constexpr uint64_t MOD = 0xFFFFFFFFULL;
+    uint64_t s1 = 0, s2 = 0;
+    while (n > 0) {
+        // s2 растёт квадратично; за 92679 слов не переполнится 64 бита
+        size_t block = n < 92679 ? n : 92679;
+        n -= block;
+        for (size_t i = 0; i < block; ++i) {
+            s1 += w[i];
+            s2 += s1;
+        }
+        w  += block;
+        s1 %= MOD;
+        s2 %= MOD;
+    }
+    return (s2 << 32) | s1;
+}
+
+static bool is_binary_file(std::string_view all) {
+    return all.size() >= sizeof(BIN_MAGIC) && std::memcmp(all.data(), BIN_MAGIC, sizeof(BIN_MAGIC)) == 0;
+}
+
+// Разбирает первую запись бинарного файла
+static BigNum parse_binary(std::string_view all, const std::string &path) {
+    BinHeader h;
+    if (all.size() < sizeof(h))
+        throw std::runtime_error("Бинарный файл повреждён (обрезан заголовок): " + path);
+    std::memcpy(&h, all.data(), sizeof(h));
+    if (h.version != BIN_VERSION)
+        throw std::runtime_error("Неподдерживаемая версия бинарного формата: " + path);
+    if (h.limb_bits != 32)
+        throw std::runtime_error("Неподдерживаемая ширина лимба в файле: " + path);
+    size_t payload = all.size() - sizeof(h);
+    if (h.limb_count == 0 || h.limb_count > payload / sizeof(uint32_t))
+        throw std::runtime_error("Бинарный файл повреждён (неверная длина): " + path);
+
+    BigNum result(static_cast<size_t>(h.limb_count));
+    std::memcpy(result.data(), all.data() + sizeof(h), result.size() * sizeof(uint32_t));
+    if (fletcher64(result.data(), result.size()) != h.checksum)
+        throw std::runtime_error("Бинарный файл повреждён (контрольная сумма): " + path);
+    while (result.size() > 1 && result.back() == 0) result.pop_back();
+    return result;
+}
+
+NumFormat format_for_path(const std::string &path) {
+    constexpr std::string_view ext = ".bin";
+    if (path.size() >= ext.size() && path.compare(path.size() - ext.size(), ext.size(), ext) == 0)
+        return NumFormat::Binary;
+    return NumFormat::Decimal;
+}
+
+void save_bignum_binary(const std::string &path, const std::vector<BigNum> &nums) {
+    FileWriter f(path);
+    for (const auto &a : nums)
+        f.write_binary(a);
+    f.close();
+}
+
+// Буфер записи: куски из конвертера мелкие (~300 цифр), системный вызов - раз на мегабайт
+static constexpr size_t WRITE_BUFFER_SIZE = 1 << 20;
+
+FileWriter::FileWriter(const std::string &path)
+    : path_(path) {
+    fd_ = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd_ < 0)
+        throw std::runtime_error("Не удалось открыть файл для записи: " + path);
+    buf_.reserve(WRITE_BUFFER_SIZE);
+}
+
+FileWriter::~FileWriter() {
+    if (fd_ >= 0) {
+        flush_with({});
+        ::close(fd_);
+    }
+}
+
+void FileWriter::write(std::string_view s) {
+    if (buf_.size() + s.size() <= WRITE_BUFFER_SIZE) {
+        buf_.append(s);
+        return;
+    }
+    // Буфер и большой кусок уходят одним writev, без копирования куска в буфер
+    flush_with(s);
+}
+
+void FileWriter::write_decimal(const BigNum &a) {
+    bignum_write_decimal(a, [this](std::string_view chunk) { write(chunk); });
+}
+
+void FileWriter::write_binary(const BigNum &a) {
+    BinHeader h;
+    std::memcpy(h.magic, BIN_MAGIC, sizeof(BIN_MAGIC));
+    h.version    = BIN_VERSION;
+    h.limb_bits  = 32;
+    h.limb_count = a.empty() ? 1 : a.size();
+    h.checksum   = a.empty() ? 0 : fletcher64(a.data(), a.size());
+    write({reinterpret_cast<const char *>(&h), sizeof(h)});
+    if (a.empty()) {
+        uint32_t zero = 0;
+        write({reinterpret_cast<const char *>(&zero), sizeof(zero)});
+    } else {
+        // Лимбы большого числа уходят в writev прямо из BigNum, без копии в буфер
+        write({reinterpret_cast<const char *>(a.data()), a.size() * sizeof(uint32_t)});
+    }
+}
+
+void FileWriter::flush_with(std::string_view tail) {
+    iovec iov[2] = {
+        {buf_.data(), buf_.size()},
+        {const_cast<char *>(tail.data()), tail.size()},
+    };
+    int first = 0;
+    while (!failed_ && first < 2) {
+        ssize_t n = ::writev(fd_, iov + first, 2 - first);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            failed_ = true;
+            break;
+        }
+        // Частичная запись: сдвигаемся по iov на записанное
+        size_t left = static_cast<size_t>(n);
+        while (first < 2 && left >= iov[first].iov_len) {
+            left -= iov[first].iov_len;
+            ++first;
+        }
+        if (first < 2) {
+            iov[first].iov_base = static_cast<char *>(iov[first].iov_base) + left;
+            iov[first].iov_len -= left;
+        }
+    }
+    buf_.clear();
+}
+
+void FileWriter::close() {
+    if (fd_ < 0) return;
+    flush_with({});
+    if (::close(fd_) != 0) failed_ = true;
+    fd_ = -1;
+    if (failed_)
+        throw std::runtime_error("Ошибка записи в файл: " + path_);
+}
+
+// Первая непустая строка без пробельных символов по краям (пустой view, если таких нет)
+static std::string_view first_number_line(std::string_view all) {
+    while (!all.empty()) {
+        size_t eol = all.find('\n');
+        std::string_view line = all.substr(0, eol);
+        all = (eol == std::string_view::npos) ? std::string_view{} : all.substr(eol + 1);
+
+        size_t start = line.find_first_not_of(" \t\r");
+        if (start == std::string_view::npos) continue;
+        size_t end = line.find_last_not_of(" \t\r");
+        return line.substr(start, end - start + 1);
+    }
+    return {};
+}
+
+// Перемешивание splitmix64: соседние входы дают несвязанные выходы
+static uint64_t splitmix64(uint64_t x) {
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+// xoshiro256** (Blackman, Vigna): 64 бита за пару тактов, для тестовых чисел более чем достаточно.
+// Состояние заполняется из 64-битного зерна через splitmix64, как советуют авторы
+struct Xoshiro256 {
+    uint64_t s[4];
+
+    explicit Xoshiro256(uint64_t seed) {
+        for (auto &w : s) {
+            w     = splitmix64(seed);
+            seed += 0x9E3779B97F4A7C15ULL;
+        }
+    }
+
+    uint64_t next() {
+        uint64_t result = std::rotl(s[1] * 5, 7) * 9;
+        uint64_t t      = s[1] << 17;
+        s[2] ^= s[0];
+        s[3] ^= s[1];
+        s[1] ^= s[2];
+        s[0] ^= s[3];
+        s[2] ^= t;
+        s[3]  = std::rotl(s[3], 45);
+        return result;
+    }
+};
+
+BigNum generate_bignum(size_t bits, uint64_t seed) {
+    if (bits < 1) bits = 1;
+    Xoshiro256 rng(seed);
+    BigNum result((bits + 31) / 32);
+    // Лимбы заполняются напрямую, по два за один шаг генератора
+    size_t i = 0;
+    for (; i + 1 < result.size(); i += 2) {
+        uint64_t r    = rng.next();
+        result[i]     = static_cast<uint32_t>(r);
+        result[i + 1] = static_cast<uint32_t>(r >> 32);
+    }
+    if (i < result.size())
+        result[i] = static_cast<uint32_t>(rng.next());
+
+    // Точная длина: всё выше старшего бита обнуляем, сам старший бит ставим
+    unsigned top_bit = static_cast<unsigned>((bits - 1) % 32);
+    if (top_bit < 31)
+        result.back() &= (1u << (top_bit + 1)) - 1;
+    result.back() |= 1u << top_bit;
+    return result;
+}
+
+uint64_t derive_seed(uint64_t base, uint64_t stream) {
+    return splitmix64(base ^ splitmix64(stream));
+}
+
+uint64_t random_seed() {
+    return (static_cast<uint64_t>(std::random_device{}()) << 32) ^ std::random_device{}();
+}
+
+// Разбивает цифры на строки по width символов (0 - без переносов)
+static void wrap_digits(std::string_view digits, size_t width, std::string &out) {
+    out.clear();
+    if (width == 0) {
+        out.assign(digits);
+        return;
+    }
+    out.reserve(digits.size() + digits.size() / width + 1);
+    for (size_t i = 0; i < digits.size(); i += width) {
+        if (i > 0) out += '\n';
+        out.append(digits.substr(i, width));
+    }
+}
+
+// Десятичная запись сгенерированного числа. GMP переводит в десятичный вид
+// субквадратично, поэтому для (необязательного) текста генератора берём его
+static std::string decimal_via_gmp(const BigNum &a) {
+    Mpz n;
+    mpz_import(n.val, a.size(), -1, sizeof(uint32_t), 0, 0, a.data());
     std::unique_ptr<char, decltype(&std::free)> str{
         mpz_get_str(nullptr, 10, n.val), std::free};
+    return std::string(str.get());
+}
 
-    std::ofstream f(path);
-    if (!f.is_open())
-        throw std::runtime_error("Cannot open file for writing: " + path);
+BigNum generate_and_save(const std::string &path,
+                         unsigned int size_bytes,
+                         uint64_t seed,
+                         std::string *text,
+                         size_t wrap_width) {
+    unsigned int bits = size_bytes * 8;
+    if (bits < 8) bits = 8; // минимум 1 байт
 
-    f << str.get() << "\n";
-}
+    BigNum n = generate_bignum(bits, seed);
 
-std::string load_from_file(const std::string &path) {
-    std::ifstream f(path);
-    if (!f.is_open())
-        throw std::runtime_error("Не удалось открыть файл: " + path);
+    if (format_for_path(path) == NumFormat::Binary) {
+        // Лимбы пишутся как есть; десятичный вид - только если его попросили
+        save_bignum_binary(path, {n});
+        if (text) wrap_digits(decimal_via_gmp(n), wrap_width, *text);
+        return n;
+    }
 
-    std::string line;
-    while (std::getline(f, line)) {
-        // Обрезаем пробельные символы
-        size_t start = line.find_first_not_of(" \t\r\n");
-        if (start == std::string::npos) continue;
-        size_t end = line.find_last_not_of(" \t\r\n");
-        line = line.substr(start, end - start + 1);
-        if (line.empty()) continue;
+    std::string str = decimal_via_gmp(n);
+    FileWriter f(path);
+    f.write(str);
+    f.write("\n");
+    f.close();
+    if (text) wrap_digits(str, wrap_width, *text);
+    return n;
+}
 
-        if (!bignum_is_valid_decimal(line))
+BigNum load_bignum_from_file(const std::string &path,
+                             std::string *text,
+                             size_t wrap_width) {
+    MappedFile f(path);
+    std::string decimal; // только для бинарного файла с запрошенным текстом
+    std::string_view line;
+    BigNum result;
+    if (is_binary_file(f.view())) {
+        result = parse_binary(f.view(), path);
+        if (!text) return result;
+        decimal = bignum_to_decimal(result);
+        line    = decimal;
+    } else {
+        line = first_number_line(f.view());
+        if (line.empty())
+            throw std::runtime_error("Файл пуст или не содержит корректного числа: " + path);
+        if (!bignum_parse_decimal(line, result))
             throw std::runtime_error("Файл содержит некорректное число: " + path);
-        return line;
     }
-    throw std::runtime_error("Файл пуст или не содержит корректного числа: " + path);
+
+    // Единственная копия цифр - та, что нужна для отображения
+    if (text) wrap_digits(line, wrap_width, *text);
+    return result;
 }
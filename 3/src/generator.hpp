@@ -1,13 +1,75 @@
 #pragma once
+#include "bignum.hpp"
+
 #include <string>
+#include <vector>
+
+// Формат файла с числом. Бинарный - лимбы как есть плюс заголовок
+// (подробности в generator.cpp); грузится за время копирования памяти
+enum class NumFormat { Decimal, Binary };
+
+// Бинарный формат выбирается по расширению ".bin", иначе десятичный
+NumFormat format_for_path(const std::string &path);
+
+// Случайное число ровно из bits бит (старший бит установлен).
+// Лимбы заполняются напрямую генератором xoshiro256**; одно зерно - одно число
+BigNum generate_bignum(size_t bits, uint64_t seed);
+
+// Зерно из std::random_device
+uint64_t random_seed();
+
+// Независимое зерно для потока stream из базового (splitmix64 от их смеси):
+// одно базовое зерно воспроизводимо задаёт сразу несколько разных чисел
+uint64_t derive_seed(uint64_t base, uint64_t stream);
+
+// Генерирует случайное число по size_bytes байт (generate_bignum)
+// и записывает его в указанный файл в формате format_for_path(path).
+// Число возвращается как есть, без разбора текста. Десятичная запись
+// для отображения строится, только если text != nullptr (переносы как у
+// load_bignum_from_file). throws std::runtime_error при ошибке ввода-вывода.
+BigNum generate_and_save(const std::string &path,
+                         unsigned int size_bytes,
+                         uint64_t seed,
+                         std::string *text = nullptr,
+                         size_t wrap_width = 0);
+
+// Записывает числа подряд в бинарном формате (по записи с заголовком на каждое).
+// throws std::runtime_error при ошибке ввода-вывода
+void save_bignum_binary(const std::string &path, const std::vector<BigNum> &nums);
+
+// Запись в файл крупными блоками через writev(2) в обход iostream.
+// write() не бросает исключений (иначе потоковая конвертация прервалась бы на середине):
+// ошибка запоминается, и о ней сообщает close()
+class FileWriter {
+public:
+    explicit FileWriter(const std::string &path); // throws std::runtime_error
+    ~FileWriter();
+    FileWriter(const FileWriter&)            = delete;
+    FileWriter& operator=(const FileWriter&) = delete;
+
+    void write(std::string_view s);
+    // Десятичная запись числа потоком из конвертера, без полной строки в памяти
+    void write_decimal(const BigNum &a);
+    // Запись бинарного формата (заголовок и лимбы, см. generator.cpp)
+    void write_binary(const BigNum &a);
+    // Сбрасывает буфер и закрывает файл; throws std::runtime_error при ошибке записи
+    void close();
+
+private:
+    void flush_with(std::string_view tail);
 
-// Генерирует случайное числа по size_bytes байт с помощью GMP
-// и записывает их десятичное представление в указанный файл.
-// throws std::runtime_error при ошибке ввода-вывода.
-void generate_and_save(const std::string &path,
-                       unsigned int size_bytes);
+    std::string path_;
+    int         fd_     = -1;
+    bool        failed_ = false;
+    std::string buf_;
+};
 
-// Считывает число из первой строки файла.
-// Throws std::runtime_error при ошибке ввода-вывода
-// или если содержимое - не положительное целое число
-std::string load_from_file(const std::string &path);
+// То же, но без промежуточных строк: файл отображается в память (mmap),
+// первая непустая строка проверяется и разбирается прямо из отображённых байт.
+// Если text != nullptr, туда же за тот же проход пишется десятичная запись,
+// разбитая на строки по wrap_width цифр (0 - без переносов) - для поля ввода.
+// Бинарные файлы распознаются по сигнатуре, из них читается первая запись
+// (десятичная запись тогда получается конвертацией).
+BigNum load_bignum_from_file(const std::string &path,
+                             std::string *text = nullptr,
+                             size_t wrap_width = 0);
@@ -0,0 +1,318 @@
+#include "limbs.hpp"
+
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#define LIMBS_HAVE_X86 1
+#endif
+
+// -----------------------------------------------------------------------
+// Переносимые версии: лимб за лимбом в 64-битной арифметике
+// -----------------------------------------------------------------------
+
+static uint32_t add_n_scalar(uint32_t *r, const uint32_t *a, const uint32_t *b, size_t n) {
+    uint64_t carry = 0;
+    for (size_t i = 0; i < n; ++i) {
+        uint64_t s = static_cast<uint64_t>(a[i]) + b[i] + carry;
+        r[i]  = static_cast<uint32_t>(s);
+        carry = s >> 32;
+    }
+    return static_cast<uint32_t>(carry);
+}
+
+static uint32_t sub_n_scalar(uint32_t *r, const uint32_t *a, const uint32_t *b, size_t n) {
+    uint32_t borrow = 0;
+    for (size_t i = 0; i < n; ++i) {
+        uint64_t d = static_cast<uint64_t>(a[i]) - b[i] - borrow;
+        r[i]   = static_cast<uint32_t>(d);
+        borrow = static_cast<uint32_t>(d >> 63); // ушли в минус - старший бит взведён
+    }
+    return borrow;
+}
+
+static uint32_t addmul_1_scalar(uint32_t *r, const uint32_t *a, size_t n, uint32_t m) {
+    uint64_t carry = 0;
+    for (size_t i = 0; i < n; ++i) {
+        // (2^32-1)^2 + 2*(2^32-1) = 2^64-1, так что переполнения нет
+        uint64_t cur = static_cast<uint64_t>(a[i]) * m + r[i] + carry;
+        r[i]  = static_cast<uint32_t>(cur);
+        carry = cur >> 32;
+    }
+    return static_cast<uint32_t>(carry);
+}
+
+static uint32_t submul_1_scalar(uint32_t *r, const uint32_t *a, size_t n, uint32_t m) {
+    uint64_t borrow = 0;
+    for (size_t i = 0; i < n; ++i) {
+        uint64_t p  = static_cast<uint64_t>(a[i]) * m + borrow;
+        uint32_t lo = static_cast<uint32_t>(p);
+        uint32_t ri = r[i];
+        r[i]   = ri - lo;
+        borrow = (p >> 32) + (ri < lo);
+    }
+    return static_cast<uint32_t>(borrow);
+}
+
+// Сдвиги: каждый лимб результата собирается из двух соседних лимбов a.
+// Влево идём сверху вниз, вправо - снизу вверх, тогда при r == a
+// лимб a перезаписывается только после того, как его прочитали оба соседа
+
+static uint32_t lshift_scalar(uint32_t *r, const uint32_t *a, size_t n, unsigned cnt) {
+    uint32_t out = a[n - 1] >> (32 - cnt);
+    for (size_t i = n - 1; i > 0; --i)
+        r[i] = (a[i] << cnt) | (a[i - 1] >> (32 - cnt));
+    r[0] = a[0] << cnt;
+    return out;
+}
+
+static uint32_t rshift_scalar(uint32_t *r, const uint32_t *a, size_t n, unsigned cnt) {
+    uint32_t out = a[0] << (32 - cnt);
+    for (size_t i = 0; i + 1 < n; ++i)
+        r[i] = (a[i] >> cnt) | (a[i + 1] << (32 - cnt));
+    r[n - 1] = a[n - 1] >> cnt;
+    return out;
+}
+
+static uint64_t dot_scalar(const uint32_t *a, const uint32_t *w, size_t n) {
+    uint64_t sum = 0;
+    for (size_t i = 0; i < n; ++i) sum += static_cast<uint64_t>(a[i]) * w[i];
+    return sum;
+}
+
+// -----------------------------------------------------------------------
+// BMI2 + ADX: два 32-битных лимба - одно 64-битное слово (little-endian,
+// так что порядок совпадает), вдвое меньше итераций. Умножение 64x32 идёт
+// через mulx (не трогает флаги, не мешает цепочке переносов), сложение -
+// через adc/adcx. Нечётный последний лимб досчитывается как в переносимой версии
+// -----------------------------------------------------------------------
+
+#ifdef LIMBS_HAVE_X86
+
+static inline unsigned long long load64(const uint32_t *p) {
+    unsigned long long v;
+    std::memcpy(&v, p, sizeof v);
+    return v;
+}
+
+static inline void store64(uint32_t *p, unsigned long long v) {
+    std::memcpy(p, &v, sizeof v);
+}
+
+__attribute__((target("bmi2,adx")))
+static uint32_t add_n_adx(uint32_t *r, const uint32_t *a, const uint32_t *b, size_t n) {
+    unsigned char c = 0;
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        unsigned long long s;
+        c = _addcarryx_u64(c, load64(a + i), load64(b + i), &s);
+        store64(r + i, s);
+    }
+    if (i < n) {
+        uint64_t s = static_cast<uint64_t>(a[i]) + b[i] + c;
+        r[i] = static_cast<uint32_t>(s);
+        c    = static_cast<unsigned char>(s >> 32);
+    }
+    return c;
+}
+
+__attribute__((target("bmi2,adx")))
+static uint32_t sub_n_adx(uint32_t *r, const uint32_t *a, const uint32_t *b, size_t n) {
+    unsigned char c = 0;
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        unsigned long long d;
+        c = _subborrow_u64(c, load64(a + i), load64(b + i), &d);
+        store64(r + i, d);
+    }
+    if (i < n) {
+        uint64_t d = static_cast<uint64_t>(a[i]) - b[i] - c;
+        r[i] = static_cast<uint32_t>(d);
+        c    = static_cast<unsigned char>(d >> 63);
+    }
+    return c;
+}
+
+__attribute__((target("bmi2,adx")))
+static uint32_t addmul_1_adx(uint32_t *r, const uint32_t *a, size_t n, uint32_t m) {
+    // Слово на 32-битный множитель - 96 бит, плюс слово r и перенос < 2^32:
+    // всё влезает в 128 бит, и цепочка переносов одна
+    unsigned long long carry = 0;
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        unsigned __int128 cur = static_cast<unsigned __int128>(load64(a + i)) * m + load64(r + i) + carry;
+        store64(r + i, static_cast<unsigned long long>(cur));
+        carry = static_cast<unsigned long long>(cur >> 64);
+    }
+    if (i < n) {
+        uint64_t cur = static_cast<uint64_t>(a[i]) * m + r[i] + carry;
+        r[i]  = static_cast<uint32_t>(cur);
+        carry = cur >> 32;
+    }
+    return static_cast<uint32_t>(carry);
+}
+
+__attribute__((target("bmi2,adx")))
+static uint32_t submul_1_adx(uint32_t *r, const uint32_t *a, size_t n, uint32_t m) {
+    // Как addmul_1, только произведение с заёмом вычитается из слова r
+    unsigned long long borrow = 0;
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        unsigned __int128  p  = static_cast<unsigned __int128>(load64(a + i)) * m + borrow;
+        unsigned long long lo = static_cast<unsigned long long>(p);
+        unsigned long long rv = load64(r + i);
+        store64(r + i, rv - lo);
+        borrow = static_cast<unsigned long long>(p >> 64) + (rv < lo);
+    }
+    if (i < n) {
+        uint64_t p  = static_cast<uint64_t>(a[i]) * m + borrow;
+        uint32_t lo = static_cast<uint32_t>(p);
+        uint32_t ri = r[i];
+        r[i]   = ri - lo;
+        borrow = (p >> 32) + (ri < lo);
+    }
+    return static_cast<uint32_t>(borrow);
+}
+
+// -----------------------------------------------------------------------
+// AVX2: в сдвигах переносов между лимбами нет, так что они векторизуются
+// честно - 8 лимбов за раз, соседние лимбы берутся невыровненной загрузкой
+// со смещением на один. Хвост, не кратный 8, - переносимым циклом
+// -----------------------------------------------------------------------
+
+__attribute__((target("avx2")))
+static uint32_t lshift_avx2(uint32_t *r, const uint32_t *a, size_t n, unsigned cnt) {
+    uint32_t out = a[n - 1] >> (32 - cnt);
+    __m128i  cl  = _mm_cvtsi32_si128(static_cast<int>(cnt));
+    __m128i  cr  = _mm_cvtsi32_si128(static_cast<int>(32 - cnt));
+    size_t   i   = n - 1;
+    // Блок r[i-7..i] читает a[i-8..i]: всё, что ниже, ещё не перезаписано
+    for (; i >= 8; i -= 8) {
+        __m256i hi = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i - 7));
+        __m256i lo = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i - 8));
+        __m256i v  = _mm256_or_si256(_mm256_sll_epi32(hi, cl), _mm256_srl_epi32(lo, cr));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(r + i - 7), v);
+    }
+    for (; i > 0; --i)
+        r[i] = (a[i] << cnt) | (a[i - 1] >> (32 - cnt));
+    r[0] = a[0] << cnt;
+    return out;
+}
+
+__attribute__((target("avx2")))
+static uint32_t rshift_avx2(uint32_t *r, const uint32_t *a, size_t n, unsigned cnt) {
+    uint32_t out = a[0] << (32 - cnt);
+    __m128i  cr  = _mm_cvtsi32_si128(static_cast<int>(cnt));
+    __m128i  cl  = _mm_cvtsi32_si128(static_cast<int>(32 - cnt));
+    size_t   i   = 0;
+    for (; i + 9 <= n; i += 8) {
+        __m256i lo = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i));
+        __m256i hi = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i + 1));
+        __m256i v  = _mm256_or_si256(_mm256_srl_epi32(lo, cr), _mm256_sll_epi32(hi, cl));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(r + i), v);
+    }
+    for (; i + 1 < n; ++i)
+        r[i] = (a[i] >> cnt) | (a[i + 1] << (32 - cnt));
+    r[n - 1] = a[n - 1] >> cnt;
+    return out;
+}
+
+// vpmuludq умножает чётные 32-битные элементы в 64-битные произведения,
+// нечётные сдвигаются на их место. Две независимые суммы по 4 лимба
+__attribute__((target("avx2")))
+static uint64_t dot_avx2(const uint32_t *a, const uint32_t *w, size_t n) {
+    __m256i even = _mm256_setzero_si256(), odd = _mm256_setzero_si256();
+    size_t  i    = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i));
+        __m256i vw = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(w + i));
+        even = _mm256_add_epi64(even, _mm256_mul_epu32(va, vw));
+        odd  = _mm256_add_epi64(odd, _mm256_mul_epu32(_mm256_srli_epi64(va, 32), _mm256_srli_epi64(vw, 32)));
+    }
+    alignas(32) uint64_t lanes[4];
+    _mm256_store_si256(reinterpret_cast<__m256i *>(lanes), _mm256_add_epi64(even, odd));
+    uint64_t sum = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    for (; i < n; ++i) sum += static_cast<uint64_t>(a[i]) * w[i];
+    return sum;
+}
+
+#endif
+
+// -----------------------------------------------------------------------
+// Выбор реализации
+// -----------------------------------------------------------------------
+
+struct LimbKernels {
+    uint32_t  (*add_n)(uint32_t *, const uint32_t *, const uint32_t *, size_t);
+    uint32_t  (*sub_n)(uint32_t *, const uint32_t *, const uint32_t *, size_t);
+    uint32_t  (*addmul_1)(uint32_t *, const uint32_t *, size_t, uint32_t);
+    uint32_t  (*submul_1)(uint32_t *, const uint32_t *, size_t, uint32_t);
+    uint32_t  (*lshift)(uint32_t *, const uint32_t *, size_t, unsigned);
+    uint32_t  (*rshift)(uint32_t *, const uint32_t *, size_t, unsigned);
+    uint64_t  (*dot)(const uint32_t *, const uint32_t *, size_t);
+    const char *name;
+};
+
+static LimbKernels select_kernels() {
+    LimbKernels k = {add_n_scalar, sub_n_scalar, addmul_1_scalar, submul_1_scalar,
+                     lshift_scalar, rshift_scalar, dot_scalar, "scalar"};
+    const char *env = std::getenv("BIGNUMS_KERNELS");
+    if (env && std::strcmp(env, "scalar") == 0) return k;
+#ifdef LIMBS_HAVE_X86
+    __builtin_cpu_init();
+    bool adx  = __builtin_cpu_supports("bmi2") && __builtin_cpu_supports("adx");
+    bool avx2 = __builtin_cpu_supports("avx2");
+    if (adx) {
+        k.add_n    = add_n_adx;
+        k.sub_n    = sub_n_adx;
+        k.addmul_1 = addmul_1_adx;
+        k.submul_1 = submul_1_adx;
+    }
+    if (avx2) {
+        k.lshift = lshift_avx2;
+        k.rshift = rshift_avx2;
+        k.dot    = dot_avx2;
+    }
+    k.name = adx && avx2 ? "bmi2-adx+avx2" : adx ? "bmi2-adx" : avx2 ? "avx2" : "scalar";
+#endif
+    return k;
+}
+
+// Выбирается при первом вызове (потокобезопасно), дальше - косвенный вызов по указателю
+static const LimbKernels &kernels() {
+    static const LimbKernels k = select_kernels();
+    return k;
+}
+
+uint32_t limbs_add_n(uint32_t *r, const uint32_t *a, const uint32_t *b, size_t n) {
+    return kernels().add_n(r, a, b, n);
+}
+
+uint32_t limbs_sub_n(uint32_t *r, const uint32_t *a, const uint32_t *b, size_t n) {
+    return kernels().sub_n(r, a, b, n);
+}
+
+uint32_t limbs_addmul_1(uint32_t *r, const uint32_t *a, size_t n, uint32_t m) {
+    return kernels().addmul_1(r, a, n, m);
+}
+
+uint32_t limbs_submul_1(uint32_t *r, const uint32_t *a, size_t n, uint32_t m) {
+    return kernels().submul_1(r, a, n, m);
+}
+
+uint32_t limbs_lshift(uint32_t *r, const uint32_t *a, size_t n, unsigned cnt) {
+    return kernels().lshift(r, a, n, cnt);
+}
+
+uint32_t limbs_rshift(uint32_t *r, const uint32_t *a, size_t n, unsigned cnt) {
+    return kernels().rshift(r, a, n, cnt);
+}
+
+uint64_t limbs_dot(const uint32_t *a, const uint32_t *w, size_t n) {
+    return kernels().dot(a, w, n);
+}
+
+const char *limbs_kernels_name() {
+    return kernels().name;
+}
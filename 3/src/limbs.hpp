@@ -0,0 +1,38 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Низкоуровневые циклы над массивами лимбов (внутреннее для bignum.cpp).
+// Реализация выбирается один раз при первом вызове по возможностям процессора:
+// на x86-64 с BMI2 и ADX сложения и умножения идут парами лимбов как 64-битные
+// слова через mulx/adcx, с AVX2 сдвиги и limbs_dot - по 8 лимбов за раз, иначе - обычный
+// переносимый код. Переменная окружения BIGNUMS_KERNELS=scalar принудительно
+// включает переносимый вариант (например, чтобы сравнить их).
+// Во всех функциях r может совпадать с a (работа на месте)
+
+// r[0..n) = a[0..n) + b[0..n), возвращает перенос (0 или 1)
+uint32_t limbs_add_n(uint32_t *r, const uint32_t *a, const uint32_t *b, size_t n);
+
+// r[0..n) = a[0..n) - b[0..n), возвращает заём (0 или 1)
+uint32_t limbs_sub_n(uint32_t *r, const uint32_t *a, const uint32_t *b, size_t n);
+
+// r[0..n) += a[0..n) * m, возвращает старший лимб (перенос за r[n-1])
+uint32_t limbs_addmul_1(uint32_t *r, const uint32_t *a, size_t n, uint32_t m);
+
+// r[0..n) -= a[0..n) * m, возвращает, сколько занять из r[n]
+uint32_t limbs_submul_1(uint32_t *r, const uint32_t *a, size_t n, uint32_t m);
+
+// r[0..n) = a[0..n) << cnt (внутри n лимбов), 1 <= cnt <= 31;
+// возвращает выдвинутые старшие биты (в младших битах результата)
+uint32_t limbs_lshift(uint32_t *r, const uint32_t *a, size_t n, unsigned cnt);
+
+// r[0..n) = a[0..n) >> cnt, 1 <= cnt <= 31; возвращает выдвинутые младшие биты
+// (в старших битах результата)
+uint32_t limbs_rshift(uint32_t *r, const uint32_t *a, size_t n, unsigned cnt);
+
+// Сумма a[i] * w[i] по i < n в 64 битах. Переполнения нет, пока
+// n * (2^32 - 1) * max(w) < 2^64 (вызывающий следит за длиной и весами)
+uint64_t limbs_dot(const uint32_t *a, const uint32_t *w, size_t n);
+
+// Название выбранной реализации: "scalar", "bmi2-adx", "avx2" или "bmi2-adx+avx2"
+const char *limbs_kernels_name();
@@ -1,14 +1,25 @@
 #include "bignum.hpp"
+#include "cli.hpp"
+#include "expr.hpp"
 #include "generator.hpp"
+#include "profile.hpp"
 
 #include <ftxui/component/component.hpp>
 #include <ftxui/component/component_options.hpp>
 #include <ftxui/component/screen_interactive.hpp>
 #include <ftxui/dom/elements.hpp>
 
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
+#include <filesystem>
 #include <format>
-#include <fstream>
+#include <future>
+#include <memory>
+#include <optional>
 #include <string>
 
 using namespace ftxui;
@@ -21,7 +32,7 @@ namespace hrc = std::chrono;
 // 3. Функция do_execute, которая запускается в отдельном потоке,
 //   выполняет выбранную операцию и обновляет состояние
 // 4. Функция run_ui, которая запускает интерфейс и обрабатывает взаимодействия
-// 5. main, который запускает UI
+// 5. main, который запускает UI или режим командной строки (cli.cpp)
 // -----------------------------------------------------------------------
 
 
@@ -41,6 +52,69 @@ static std::string fmt_ms(double ms) {
     return std::format("{:.3f} мс", ms);
 }
 
+static std::string fmt_bytes(uint64_t bytes) {
+    if (bytes >= (1u << 20)) return std::format("{:.1f} МБ", bytes / 1048576.0);
+    if (bytes >= (1u << 10)) return std::format("{:.1f} КБ", bytes / 1024.0);
+    return std::format("{} Б", bytes);
+}
+
+// Убирает все лишние символы из строки, оставляя только десятичные цифры
+static std::string digits_only(const std::string &s) {
+    std::string r;
+    r.reserve(s.size());
+    for (char c : s)
+        if (c >= '0' && c <= '9') r += c;
+    return r;
+}
+
+// Подсчет десятичных цифр в строке
+static size_t count_digits(const std::string &s) {
+    size_t cnt = 0;
+    for (char c : s) if (c >= '0' && c <= '9') ++cnt;
+    return cnt;
+}
+
+// Размер числа для подписей: цифры, лимбы и память под них. Пока число не
+// разобрано и точный размер не посчитан в фоне, лимбы оцениваются по цифрам (exact == false)
+struct NumSize {
+    size_t digits = 0;
+    size_t limbs  = 0;
+    bool   exact  = false;
+};
+
+static NumSize num_size(const BigNum &a) {
+    return {bignum_decimal_digits(a), a.size(), true};
+}
+
+static NumSize num_size_estimate(size_t digits) {
+    // log2(10) / 32 бит на цифру, с запасом в лимб
+    return {digits, static_cast<size_t>(static_cast<double>(digits) * 0.10381025296523008) + 1, false};
+}
+
+// "N цифр, L лимбов, X КБ" (у оценки - с тильдой)
+static std::string fmt_num_size(const NumSize &sz) {
+    std::string approx = sz.exact ? "" : "~";
+    return std::to_string(sz.digits) + " цифр, " + approx + std::to_string(sz.limbs) + " лимбов, "
+           + approx + fmt_bytes(sz.limbs * sizeof(uint32_t));
+}
+
+// Разбить длинное число на строки по width символов для удобного отображения
+static std::string wrap_number(const std::string &s, size_t width = 80) {
+    if (s.empty()) return s;
+    std::string result;
+    result.reserve(s.size() + s.size() / width + 1);
+    for (size_t i = 0; i < s.size(); i += width) {
+        if (i > 0) result += '\n';
+        result += s.substr(i, width);
+    }
+    return result;
+}
+
+// Результаты длиннее этого показываются частично: RESULT_PREVIEW_DIGITS
+// цифр в начале и в конце, чтобы не конвертировать число целиком ради экрана
+static constexpr size_t RESULT_FULL_TEXT_DIGITS = 20000;
+static constexpr size_t RESULT_PREVIEW_DIGITS   = 2000;
+
 // -----------------------------------------------------------------------
 // Состояние приложения
 // -----------------------------------------------------------------------
@@ -53,29 +127,41 @@ struct AppState {
     // Пути к файлам и размер генерации
     std::string file_a         = "num_a.txt";
     std::string file_b         = "num_b.txt";
-    std::string file_out       = "result.txt";
+    std::string file_out       = "";     // пусто - результат не сохраняется
     std::string gen_bytes_str  = "256";  // размер числа в байтах
+    std::string seed_str       = "";     // зерно генерации, пусто - случайное
     // Параметры операций
     std::string exp_input      = "2";   // степень (1-3)
+    std::string expr_input     = "(A*B + A^3) mod B";
 
     // Текущая операция: 0=Сложение, 1=Умножение, 2=Деление,
-    //   3=Степень, 4=Простота, 5=Сравнение
+    //   3=Степень, 4=Простота, 5=Сравнение, 6=Выражение
     int  selected_op = 0;
     int  target_ab   = 0;  // 0=A, 1=B (для степени и простоты)
-    int  selected_option_component = 0; // 0=dropdown, 1=target_radio, 2=input_exp_tracked
+    int  selected_option_component = 0; // 0=dropdown, 1=target_radio, 2=input_exp_tracked, 3=input_expr_tracked
 
     // Результат и статус
-    std::string result_text  = "";
+    std::string result_text  = "";     // текст для экрана; у больших чисел - начало и конец
+    std::vector<BigNum> result_nums;   // результат-число в двоичном виде (частное и остаток - два)
+    size_t      result_digits = 0;     // точное количество цифр результата
+    size_t      result_limbs  = 0;     // лимбов в числах результата (0 - результат не число)
+    int         result_root   = -1;    // цифровой корень результата, -1 = н/д
     std::string status_msg   = "";     // сообщение об ошибке / инфо
     bool        result_stale = false;  // входы изменились после последнего выполнения
     bool        is_working   = false;  // идёт фоновая работа
     int         spinner_idx  = 0;
     TimePoint   spinner_last = Clock::now();
 
-    // Исключение девяток (для сложения)
-    bool show_con            = false;
-    int  con_ra = 0, con_rb = 0, con_rs = 0;
-    bool con_ok              = false;
+    // Проверка результата по остаткам (сложение, умножение, деление, степень)
+    bool           show_con = false;
+    std::string    con_relation;   // что сверяется, например "A * B"
+    BigNumResidues con_expected;   // посчитано по остаткам операндов
+    BigNumResidues con_actual;     // остатки самого результата
+    std::string    con_error;      // ошибка, которую остатками не поймать (остаток >= делителя)
+
+    // Профиль по ядрам (profile.hpp): собирается, только пока панель открыта
+    bool                 show_prof = false;
+    std::vector<ProfRow> prof_rows;
 
     // Тайминги: -1.0 = не применимо, -2.0 = кэширован, >= 0 = время в мс
     double t_parse_a = -1.0;
@@ -88,9 +174,93 @@ struct AppState {
     BigNum      cached_bn_b;
     bool        cache_a_valid = false;
     bool        cache_b_valid = false;
+    // Цифры, из которых получен кэш (пусто - неизвестны). Остаются после правки
+    // числа, чтобы следующий разбор пересчитал только изменённый участок
+    std::string cached_digits_a;
+    std::string cached_digits_b;
+    // Версии чисел: растут при каждой правке, загрузке и генерации.
+    // Разбор, начатый для старой версии, свой результат в кэш не кладёт
+    uint64_t    version_a = 0;
+    uint64_t    version_b = 0;
+    // Число пришло из результата: кэш актуален, а десятичная запись для поля
+    // ввода ещё строится в фоне (см. run_bg_parser). Пока её нет, поле пустое
+    bool        text_pending_a = false;
+    bool        text_pending_b = false;
+    // Точный размер закэшированного числа для подписи (см. num_size) и версия,
+    // для которой он посчитан. Считает фоновый поток раз на версию, рендер только читает
+    NumSize     size_a, size_b;
+    uint64_t    size_version_a = UINT64_MAX;
+    uint64_t    size_version_b = UINT64_MAX;
+
+    // Граф последнего выражения с кэшем узлов. Трогает только do_execute (он
+    // всегда один), поэтому без блокировки; пересобирается при смене текста
+    std::unique_ptr<ExprGraph> expr_graph;
+
+    // Фоновый разбор (см. run_bg_parser)
+    TimePoint         last_edit     = Clock::now();
+    bool              bg_parsing_a  = false;
+    bool              bg_parsing_b  = false;
+    uint64_t          bg_rejected_a = UINT64_MAX; // версия с некорректным вводом, повторно не разбираем
+    uint64_t          bg_rejected_b = UINT64_MAX;
+    std::atomic<bool> bg_cancel{false};           // число изменилось во время фонового разбора
+    bool              quitting      = false;
 
     // Блокировка для рабочего треда
     std::mutex mtx;
+    // Сигнал о смене состояния разбора (будит фоновый разбор и ждущий его do_execute)
+    std::condition_variable cv;
+};
+
+// Ссылки на поля одного из чисел (0 = A, 1 = B), чтобы не дублировать код для A и B
+struct OperandRef {
+    std::string &input;
+    BigNum      &cached_bn;
+    std::string &cached_digits;
+    bool        &cache_valid;
+    uint64_t    &version;
+    bool        &text_pending;
+    bool        &bg_parsing;
+    uint64_t    &bg_rejected;
+    NumSize     &size;
+    uint64_t    &size_version;
+};
+
+static OperandRef operand_ref(AppState &st, int which) {
+    if (which == 0)
+        return {st.input_a, st.cached_bn_a, st.cached_digits_a, st.cache_a_valid,
+                st.version_a, st.text_pending_a, st.bg_parsing_a, st.bg_rejected_a,
+                st.size_a, st.size_version_a};
+    return {st.input_b, st.cached_bn_b, st.cached_digits_b, st.cache_b_valid,
+            st.version_b, st.text_pending_b, st.bg_parsing_b, st.bg_rejected_b,
+            st.size_b, st.size_version_b};
+}
+
+// Число изменилось (правка, загрузка, генерация): новая версия, идущий
+// фоновый разбор старой версии отменяется, недостроенная запись больше не нужна.
+// Вызывается под блокировкой
+static void bump_version(AppState &st, const OperandRef &op) {
+    ++op.version;
+    op.text_pending = false;
+    if (op.bg_parsing) st.bg_cancel = true;
+}
+
+// Разбор цифр: инкрементально от прошлой версии числа, если она есть и правка
+// небольшая, иначе целиком с проверкой. false - цифры некорректны или разбор отменён
+static bool parse_operand(const std::string &digits, BigNum base, const std::string &base_digits,
+                          BigNum &out, const std::atomic<bool> *cancel = nullptr) {
+    if (!base_digits.empty() && bignum_is_valid_decimal(digits)
+        && bignum_update_decimal(base, base_digits, digits)) {
+        out = std::move(base);
+        return true;
+    }
+    return bignum_parse_decimal(digits, out, cancel);
+}
+
+// Сгенерированное число до публикации в состояние
+struct GeneratedNumber {
+    BigNum      value;
+    std::string text;  // десятичная запись с переносами для поля ввода
+    bool        text_pending = false; // записи нет, её построит фоновый поток
 };
 
 // -----------------------------------------------------------------------
@@ -105,37 +275,57 @@ static void do_execute(AppState &st) {
     std::string input_a;
     std::string input_b;
     std::string exp_input;
+    std::string expr_input;
     int         selected_op = 0;
     int         target_ab   = 0;
     std::string file_out_path;
     bool        cache_a_valid;
     bool        cache_b_valid;
+    // Прошлый разбор устаревшего числа - основа для инкрементального
+    BigNum      base_bn_a, base_bn_b;
+    std::string base_digits_a, base_digits_b;
+    uint64_t    version_a, version_b;
+    bool        profile = false;
     {
-        std::lock_guard<std::mutex> lock(st.mtx);
-        input_a       = st.input_a;
-        input_b       = st.input_b;
+        std::unique_lock<std::mutex> lock(st.mtx);
+        // Если число уже разбирается в фоне, дожидаемся: это быстрее, чем начинать заново
+        st.cv.wait(lock, [&st] { return !st.bg_parsing_a && !st.bg_parsing_b; });
+        version_a = st.version_a;
+        version_b = st.version_b;
+        // Текст нужен только для разбора, а при актуальном кэше разбирать нечего
+        if (!st.cache_a_valid) input_a = st.input_a;
+        if (!st.cache_b_valid) input_b = st.input_b;
+        if (!st.cache_a_valid && !st.cached_digits_a.empty()) {
+            base_bn_a     = st.cached_bn_a;
+            base_digits_a = st.cached_digits_a;
+        }
+        if (!st.cache_b_valid && !st.cached_digits_b.empty()) {
+            base_bn_b     = st.cached_bn_b;
+            base_digits_b = st.cached_digits_b;
+        }
         exp_input     = st.exp_input;
+        expr_input    = st.expr_input;
         selected_op   = st.selected_op;
         target_ab     = st.target_ab;
         file_out_path = st.file_out;
         cache_a_valid = st.cache_a_valid;
         cache_b_valid = st.cache_b_valid;
+        profile       = st.show_prof;
         st.show_con   = false;
+        st.prof_rows.clear();
         // Сбрасываем тайминги, новые будут установлены по мере выполнения
         st.t_parse_a = st.t_parse_b = st.t_op = st.t_to_dec = -1.0;
     }
 
-    // Убирает все лишние символы из строки, оставляя только десятичные цифры
-    auto digits_only = [](const std::string &s) -> std::string {
-        std::string r;
-        r.reserve(s.size());
-        for (char c : s)
-            if (c >= '0' && c <= '9') r += c;
-        return r;
-    };
+    // Профиль - от разбора до записи результата; выключается при любом выходе
+    struct ProfRun {
+        bool on;
+        ~ProfRun() { if (on) prof_stop(); }
+    } prof_run{profile};
+    if (profile) prof_start();
 
-    std::string sa = digits_only(input_a);
-    std::string sb = digits_only(input_b);
+    std::string sa = cache_a_valid ? std::string() : digits_only(input_a);
+    std::string sb = cache_b_valid ? std::string() : digits_only(input_b);
 
     bool should_check_a_valid = true;
     bool should_check_b_valid = true;
@@ -146,7 +336,32 @@ static void do_execute(AppState &st) {
         should_check_b_valid = (target_ab == 1);
     }
 
-    // Валидация входных чисел
+    // Выражение: нужны только те числа, что в нём встречаются
+    ExprGraph *expr = nullptr;
+    if (selected_op == 6) {
+        try {
+            // Тот же текст - тот же граф, и его кэш узлов переживает выполнение
+            if (!st.expr_graph || st.expr_graph->text() != expr_input)
+                st.expr_graph = std::make_unique<ExprGraph>(expr_input);
+        } catch (const std::exception &ex) {
+            std::lock_guard<std::mutex> lock(st.mtx);
+            st.status_msg   = std::string("Ошибка в выражении: ") + ex.what();
+            st.is_working   = false;
+            return;
+        }
+        expr = st.expr_graph.get();
+        should_check_a_valid = expr->uses_a();
+        should_check_b_valid = expr->uses_b();
+    }
+
+    // Разбираем только числа, нужные операции: ненужное может быть некорректным
+    // (об этом скажут, когда его выберут), и в кэш оно попасть не должно
+    const bool need_a = should_check_a_valid;
+    const bool need_b = should_check_b_valid;
+
+    // Валидация входных чисел (закэшированные уже проверены при разборе)
+    if (cache_a_valid) should_check_a_valid = false;
+    if (cache_b_valid) should_check_b_valid = false;
     if (should_check_a_valid && sa.empty()) {
         std::lock_guard<std::mutex> lock(st.mtx);
         st.status_msg   = "Ошибка: число A пустое";
@@ -184,40 +399,73 @@ static void do_execute(AppState &st) {
         }
     }
 
+    // Простота и сравнение дают текст: в .bin он был бы не бинарным файлом,
+    // который потом не загрузить
+    if ((selected_op == 4 || selected_op == 5) && format_for_path(file_out_path) == NumFormat::Binary) {
+        std::lock_guard<std::mutex> lock(st.mtx);
+        st.status_msg   = "Ошибка: результат этой операции - текст, его нельзя сохранить в .bin";
+        st.is_working   = false;
+        return;
+    }
+
     // Парсинг больших чисел
     BigNum bn_a, bn_b;
-    if (!sa.empty()) {
+    if (need_a) {
         if (cache_a_valid) {
             std::lock_guard<std::mutex> lock(st.mtx);
             bn_a = st.cached_bn_a;
             st.t_parse_a = -2.0; // кэшировано
         } else {
             auto t0 = Clock::now();
-            bn_a = bignum_from_decimal(sa);
+            // Число правили после прошлого разбора - пробуем пересчитать только правку
+            bool ok = parse_operand(sa, std::move(base_bn_a), base_digits_a, bn_a);
             auto t1 = Clock::now();
             {
                 std::lock_guard<std::mutex> lock(st.mtx);
-                st.t_parse_a     = ms_between(t0, t1);
-                st.cached_bn_a   = bn_a;
-                st.cache_a_valid = true;
+                st.t_parse_a = ms_between(t0, t1);
+                if (!ok) {
+                    // Как в run_bg_parser: эту версию больше не разбираем
+                    if (st.version_a == version_a) st.bg_rejected_a = version_a;
+                    st.status_msg   = "Ошибка: число A содержит недопустимые символы или ведущие нули";
+                    st.is_working   = false;
+                    return;
+                }
+                // Пока разбирали, число могли снова изменить - тогда кэш не трогаем
+                if (st.version_a == version_a) {
+                    st.cached_bn_a     = bn_a;
+                    st.cached_digits_a = std::move(sa);
+                    st.cache_a_valid   = true;
+                }
             }
         }
     }
 
-    if (!sb.empty()) {
+    if (need_b) {
         if (cache_b_valid) {
             std::lock_guard<std::mutex> lock(st.mtx);
             bn_b = st.cached_bn_b;
             st.t_parse_b = -2.0; // кэшировано
         } else {
             auto t0 = Clock::now();
-            bn_b = bignum_from_decimal(sb);
+            // Число правили после прошлого разбора - пробуем пересчитать только правку
+            bool ok = parse_operand(sb, std::move(base_bn_b), base_digits_b, bn_b);
             auto t1 = Clock::now();
             {
                 std::lock_guard<std::mutex> lock(st.mtx);
-                st.t_parse_b     = ms_between(t0, t1);
-                st.cached_bn_b   = bn_b;
-                st.cache_b_valid = true;
+                st.t_parse_b = ms_between(t0, t1);
+                if (!ok) {
+                    // Как в run_bg_parser: эту версию больше не разбираем
+                    if (st.version_b == version_b) st.bg_rejected_b = version_b;
+                    st.status_msg   = "Ошибка: число B содержит недопустимые символы или ведущие нули";
+                    st.is_working   = false;
+                    return;
+                }
+                // Пока разбирали, число могли снова изменить - тогда кэш не трогаем
+                if (st.version_b == version_b) {
+                    st.cached_bn_b     = bn_b;
+                    st.cached_digits_b = std::move(sb);
+                    st.cache_b_valid   = true;
+                }
             }
         }
     }
@@ -226,43 +474,51 @@ static void do_execute(AppState &st) {
     // тайминги
     double      local_t_op     = -1.0;
     double      local_t_to_dec = -1.0;
-    // проверка сложения (исключение девяток)
-    bool        local_show_con = false;
-    int         local_con_ra = 0, local_con_rb = 0, local_con_rs = 0;
-    bool        local_con_ok   = false;
+    // проверка по остаткам
+    bool           local_show_con = false;
+    std::string    local_con_relation, local_con_error;
+    BigNumResidues local_con_expected, local_con_actual;
     std::string op_result_text;
+    // Числовые результаты и подписи перед ними (частное и остаток - два числа).
+    // Конвертируются в десятичный вид уже после операции, сразу в файл и на экран
+    std::vector<BigNum>      op_result_nums;
+    std::vector<std::string> op_result_labels;
+    std::string              status_note; // дописывается к "Готово"
 
     try {
         auto op_start = Clock::now();
 
         // Некоторые операции завершаются идентично
-        auto finish_bignum = [&](BigNum bn) {
+        auto finish_bignum = [&](BigNum bn, std::string label = "") {
+            op_result_nums.push_back(std::move(bn));
+            op_result_labels.push_back(std::move(label));
             local_t_op = ms_between(op_start, Clock::now());
             {
                 std::lock_guard<std::mutex> lock(st.mtx);
                 st.t_op = local_t_op;
             }
-            auto t0        = Clock::now();
-            op_result_text = bignum_to_decimal(bn);
-            auto t1        = Clock::now();
-            local_t_to_dec = ms_between(t0, t1);
+        };
+
+        // Сверка остатков: expected - по операндам, actual - остатки результата.
+        // Один проход по числам, так что после операции это почти бесплатно
+        auto check_residues = [&](std::string relation, BigNumResidues expected, BigNumResidues actual) {
+            local_con_relation = std::move(relation);
+            local_con_expected = expected;
+            local_con_actual   = actual;
+            local_show_con     = true;
         };
 
         switch (selected_op) {
             case 0: { // Сложение
-                BigNum sum  = bignum_add(bn_a, bn_b);
-
-                local_con_ra   = bignum_digit_root_mod_9(bn_a);
-                local_con_rb   = bignum_digit_root_mod_9(bn_b);
-                local_con_rs   = bignum_digit_root_mod_9(sum);
-                local_con_ok   = (local_con_ra + local_con_rb) % 9 == local_con_rs % 9;
-                local_show_con = true;
-
-                finish_bignum(sum);
+                finish_bignum(bignum_add(bn_a, bn_b));
+                check_residues("A + B", residues_add(bignum_residues(bn_a), bignum_residues(bn_b)),
+                               bignum_residues(op_result_nums[0]));
                 break;
             }
             case 1: { // Умножение
                 finish_bignum(bignum_mul(bn_a, bn_b));
+                check_residues("A * B", residues_mul(bignum_residues(bn_a), bignum_residues(bn_b)),
+                               bignum_residues(op_result_nums[0]));
                 break;
             }
             case 2: { // Деление с остатком
@@ -273,24 +529,23 @@ static void do_execute(AppState &st) {
                     return;
                 }
                 auto [q, r] = bignum_divmod(bn_a, bn_b);
-                local_t_op   = ms_between(op_start, Clock::now());
-                {
-                    std::lock_guard<std::mutex> lock(st.mtx);
-                    st.t_op = local_t_op;
-                }
-
-                auto t0 = Clock::now();
-                std::string qs     = bignum_to_decimal(q);
-                std::string rs_str = bignum_to_decimal(r);
-                auto t1 = Clock::now();
-                local_t_to_dec = ms_between(t0, t1);
-
-                op_result_text = "Частное:\n" + qs + "\n\nОстаток:\n" + rs_str;
+                finish_bignum(std::move(q), "Частное:\n");
+                finish_bignum(std::move(r), "\n\nОстаток:\n");
+                // Частное * B + остаток = A, и остаток меньше делителя
+                const BigNum &rq = op_result_nums[0], &rr = op_result_nums[1];
+                BigNumResidues res_b = bignum_residues(bn_b);
+                check_residues("частное * B + остаток = A",
+                               residues_add(residues_mul(bignum_residues(rq), res_b), bignum_residues(rr)),
+                               bignum_residues(bn_a));
+                if (bignum_cmp(rr, bn_b) >= 0) local_con_error = "остаток не меньше делителя";
                 break;
             }
             case 3: { // Степень
                 BigNum &base_bn = (target_ab == 0) ? bn_a : bn_b;
                 finish_bignum(bignum_pow(base_bn, exp_val));
+                check_residues(std::string(target_ab == 0 ? "A" : "B") + "^" + std::to_string(exp_val),
+                               residues_pow(bignum_residues(base_bn), exp_val),
+                               bignum_residues(op_result_nums[0]));
                 break;
             }
             case 4: { // Простота
@@ -314,6 +569,13 @@ static void do_execute(AppState &st) {
                 else              op_result_text = "A = B";
                 break;
             }
+            case 6: { // Выражение
+                ExprGraph::Stats es;
+                finish_bignum(expr->evaluate(bn_a, version_a, bn_b, version_b, &es));
+                status_note = " (узлов посчитано: " + std::to_string(es.computed)
+                            + ", из кэша: " + std::to_string(es.reused) + ")";
+                break;
+            }
         }
     } catch (const std::exception &ex) {
         std::lock_guard<std::mutex> lock(st.mtx);
@@ -322,33 +584,221 @@ static void do_execute(AppState &st) {
         return;
     }
 
+    // Результат-число остаётся в двоичном виде. Для экрана небольшие числа
+    // конвертируются целиком, у больших - только начало и конец. Полная
+    // десятичная конвертация идёт потоком и только при записи в десятичный файл
     std::string save_error;
-    try {
-        std::ofstream ofs(file_out_path);
-        if (!ofs) throw std::runtime_error("Не удалось открыть файл для записи: " + file_out_path);
-        ofs << op_result_text;
-        if (!ofs) throw std::runtime_error("Ошибка записи в файл: " + file_out_path);
-    } catch (const std::exception &ex) {
-        save_error = std::string("Ошибка записи результата: ") + ex.what();
+    std::optional<FileWriter> out;
+    if (!file_out_path.empty()) { // пустое имя - результат не сохраняется
+        try {
+            // Результаты-числа в .bin пишутся лимбами (текстовые операции в .bin отсеяны выше)
+            if (format_for_path(file_out_path) == NumFormat::Binary)
+                save_bignum_binary(file_out_path, op_result_nums);
+            else
+                out.emplace(file_out_path);
+        } catch (const std::exception &ex) {
+            save_error = std::string("Ошибка записи результата: ") + ex.what();
+        }
+    }
+
+    size_t local_result_digits = 0;
+    size_t local_result_limbs  = 0;
+    int    local_result_root   = -1;
+    if (!op_result_nums.empty()) {
+        auto t0 = Clock::now();
+        auto emit = [&](std::string_view chunk) {
+            op_result_text.append(chunk);
+            if (out) out->write(chunk);
+        };
+        for (size_t i = 0; i < op_result_nums.size(); ++i) {
+            const BigNum &num    = op_result_nums[i];
+            size_t        digits = bignum_decimal_digits(num);
+            local_result_digits += digits;
+            local_result_limbs  += num.size();
+            emit(op_result_labels[i]);
+            if (digits <= RESULT_FULL_TEXT_DIGITS) {
+                // Одна конвертация сразу в файл и на экран
+                bignum_write_decimal(num, emit);
+                continue;
+            }
+            std::string head, tail;
+            if (out) {
+                // Файл всё равно пишется целиком - начало и конец для экрана берём
+                // из того же потока цифр, без отдельных делений на 10^k
+                bignum_write_decimal(num, [&](std::string_view chunk) {
+                    out->write(chunk);
+                    if (head.size() < RESULT_PREVIEW_DIGITS)
+                        head.append(chunk.substr(0, RESULT_PREVIEW_DIGITS - head.size()));
+                    tail.append(chunk.substr(chunk.size() > RESULT_PREVIEW_DIGITS ? chunk.size() - RESULT_PREVIEW_DIGITS : 0));
+                    if (tail.size() > 2 * RESULT_PREVIEW_DIGITS) tail.erase(0, tail.size() - RESULT_PREVIEW_DIGITS);
+                });
+                if (tail.size() > RESULT_PREVIEW_DIGITS) tail.erase(0, tail.size() - RESULT_PREVIEW_DIGITS);
+            } else {
+                head = bignum_leading_digits(num, RESULT_PREVIEW_DIGITS);
+                tail = bignum_trailing_digits(num, RESULT_PREVIEW_DIGITS);
+            }
+            op_result_text += head;
+            op_result_text += "\n... ещё " + std::to_string(digits - 2 * RESULT_PREVIEW_DIGITS) + " цифр ...\n";
+            op_result_text += tail;
+        }
+        if (op_result_nums.size() == 1) {
+            // Цифровой корень по остатку от деления на 9, без цифр
+            int r9 = bignum_digit_root_mod_9(op_result_nums[0]);
+            local_result_root = bignum_is_zero(op_result_nums[0]) ? 0 : (r9 == 0 ? 9 : r9);
+        }
+        local_t_to_dec = ms_between(t0, Clock::now());
+    } else {
+        local_result_digits = count_digits(op_result_text);
+        if (out) out->write(op_result_text);
+    }
+
+    if (out) {
+        try {
+            out->close();
+        } catch (const std::exception &ex) {
+            save_error = std::string("Ошибка записи результата: ") + ex.what();
+        }
+    }
+
+    std::vector<ProfRow> local_prof_rows;
+    if (profile) {
+        prof_stop();
+        local_prof_rows = prof_rows();
     }
 
     // Запись состояния
     {
         std::lock_guard<std::mutex> lock(st.mtx);
-        st.result_text  = op_result_text;
+        st.prof_rows      = std::move(local_prof_rows);
+        st.result_text    = op_result_text;
+        st.result_nums    = std::move(op_result_nums);
+        st.result_digits  = local_result_digits;
+        st.result_limbs   = local_result_limbs;
+        st.result_root    = local_result_root;
         st.t_op         = local_t_op;
         st.t_to_dec     = local_t_to_dec;
         st.show_con     = local_show_con;
-        st.con_ra       = local_con_ra;
-        st.con_rb       = local_con_rb;
-        st.con_rs       = local_con_rs;
-        st.con_ok       = local_con_ok;
+        st.con_relation = std::move(local_con_relation);
+        st.con_expected = local_con_expected;
+        st.con_actual   = local_con_actual;
+        st.con_error    = std::move(local_con_error);
         st.result_stale = false;
-        st.status_msg   = save_error.empty() ? "Готово" : save_error;
+        st.status_msg   = !save_error.empty() ? save_error
+                        : (file_out_path.empty() ? "Готово (результат не сохранён)" : "Готово") + status_note;
         st.is_working   = false;
     }
 }
 
+// -----------------------------------------------------------------------
+// Фоновый разбор
+// -----------------------------------------------------------------------
+
+// Пауза во вводе, после которой число начинают разбирать заранее
+static constexpr double BG_PARSE_IDLE_MS = 400.0;
+
+// Работает всё время жизни интерфейса. Как только число изменилось и ввод
+// затих, разбирает его с низким приоритетом, чтобы к нажатию "Выполнить"
+// кэш уже был актуален. Новая правка отменяет начатый разбор.
+// Заодно строит десятичную запись чисел, перенесённых из результата;
+// on_update - перерисовать экран, когда запись готова
+static void run_bg_parser(AppState &st, const std::function<void()> &on_update) {
+    // В Linux приоритет (nice) у каждого потока свой; 0 - вызывающий поток
+    setpriority(PRIO_PROCESS, 0, 19);
+
+    std::unique_lock<std::mutex> lock(st.mtx);
+    // Разбирает одно число, если есть что; блокировка снимается на время разбора
+    auto try_parse = [&](int which) -> bool {
+        OperandRef op = operand_ref(st, which);
+        if (op.cache_valid || op.input.empty() || op.bg_rejected == op.version) return false;
+        if (st.is_working) return false; // не мешаем выполнению и генерации
+        if (ms_between(st.last_edit, Clock::now()) < BG_PARSE_IDLE_MS) return false;
+
+        std::string text    = op.input;
+        uint64_t    version = op.version;
+        BigNum      base;
+        std::string base_digits;
+        if (!op.cached_digits.empty()) {
+            base        = op.cached_bn;
+            base_digits = op.cached_digits;
+        }
+        op.bg_parsing = true;
+        st.bg_cancel  = false;
+        lock.unlock();
+
+        std::string digits = digits_only(text);
+        BigNum      bn;
+        bool        ok = parse_operand(digits, std::move(base), base_digits, bn, &st.bg_cancel);
+
+        lock.lock();
+        op.bg_parsing = false;
+        if (op.version == version) {
+            if (ok) {
+                op.cached_bn     = std::move(bn);
+                op.cached_digits = std::move(digits);
+                op.cache_valid   = true;
+            } else {
+                op.bg_rejected = version; // некорректный ввод, об ошибке скажет do_execute
+            }
+        }
+        st.cv.notify_all();
+        return true;
+    };
+
+    // Строит запись числа из кэша для поля ввода; блокировка снимается на время конвертации
+    auto try_format = [&](int which) -> bool {
+        OperandRef op = operand_ref(st, which);
+        if (!op.text_pending) return false;
+
+        BigNum   bn      = op.cached_bn;
+        uint64_t version = op.version;
+        lock.unlock();
+
+        std::string text = wrap_number(bignum_to_decimal(bn), 80);
+
+        lock.lock();
+        // Число успели заменить или начали править - запись уже не нужна
+        if (op.version == version && op.text_pending) {
+            op.input        = std::move(text);
+            op.text_pending = false;
+            on_update();
+        }
+        return true;
+    };
+
+    // Точный размер числа для подписи. bignum_decimal_digits у числа рядом со
+    // степенью десяти считает 10^k целиком, поэтому - здесь и раз на версию, а не
+    // в рендере на каждом кадре. Во время выполнения не считаем: не мешаем профилю
+    auto try_size = [&](int which) -> bool {
+        OperandRef op = operand_ref(st, which);
+        if (!op.cache_valid || op.size_version == op.version || st.is_working) return false;
+
+        BigNum   bn      = op.cached_bn;
+        uint64_t version = op.version;
+        lock.unlock();
+
+        NumSize size = num_size(bn);
+
+        lock.lock();
+        if (op.version == version) {
+            op.size         = size;
+            op.size_version = version;
+            on_update();
+        }
+        return true;
+    };
+
+    while (!st.quitting) {
+        bool worked = try_size(0);
+        worked      = try_size(1) || worked;
+        worked      = try_format(0) || worked;
+        worked      = try_format(1) || worked;
+        worked      = try_parse(0) || worked;
+        worked      = try_parse(1) || worked;
+        if (!worked)
+            st.cv.wait_for(lock, std::chrono::milliseconds(100));
+    }
+}
+
 // -----------------------------------------------------------------------
 // Графический интерфейс
 // -----------------------------------------------------------------------
@@ -362,6 +812,7 @@ static const std::vector<std::string> OP_NAMES = {
     "Возведение в степень",
     "Проверка на простоту",
     "Сравнение",
+    "Выражение",
 };
 
 // ms < 0  -> н/д
@@ -385,25 +836,6 @@ static Element timing_row(const std::string &label, double ms) {
     });
 }
 
-// Разбить длинное число на строки по width символов для удобного отображения
-static std::string wrap_number(const std::string &s, size_t width = 80) {
-    if (s.empty()) return s;
-    std::string result;
-    result.reserve(s.size() + s.size() / width + 1);
-    for (size_t i = 0; i < s.size(); i += width) {
-        if (i > 0) result += '\n';
-        result += s.substr(i, width);
-    }
-    return result;
-}
-
-// Подсчет десятичных цифр в строке
-static size_t count_digits(const std::string &s) {
-    size_t cnt = 0;
-    for (char c : s) if (c >= '0' && c <= '9') ++cnt;
-    return cnt;
-}
-
 // цветные кнопочки
 static ButtonOption SmallAnimatedButtonOption(Color color) {
   ButtonOption option;
@@ -436,8 +868,10 @@ static void run_ui() {
     auto input_fa  = Input(&st.file_a, "num_a.txt", single_line);
     auto input_fb  = Input(&st.file_b, "num_b.txt", single_line);
     auto input_gb  = Input(&st.gen_bytes_str, "256", single_line);
-    auto input_out = Input(&st.file_out, "result.txt", single_line);
+    auto input_sd  = Input(&st.seed_str, "случайное", single_line);
+    auto input_out = Input(&st.file_out, "не сохранять", single_line);
     auto input_exp = Input(&st.exp_input, "1-3", single_line);
+    auto input_expr = Input(&st.expr_input, "(A*B + A^3) mod B", single_line);
 
     // Просмотр результата
     auto readonly_input = CatchEvent([](Event e) {
@@ -448,22 +882,41 @@ static void run_ui() {
     std::string result_display_text;
     auto result_input = Input(&result_display_text, "") | readonly_input;
 
+    // Панель профиля: таблица строится в основном рендерере из снимка состояния
+    Element prof_table = text("");
+    auto prof_panel = Collapsible(" Профиль по ядрам (собирается при открытой панели)",
+                                  Renderer([&prof_table] { return prof_table; }), &st.show_prof);
+
     // Отмечаем результат устаревшим при любом вводе символа
-    auto mark_stale = [&st](std::optional<std::reference_wrapper<bool>> cache_value = std::nullopt) {
-        return CatchEvent([&st, cache_value](Event e) {
+    // on_edit вызывается под блокировкой до того, как поле применит правку
+    auto mark_stale = [&st](std::function<void()> on_edit = nullptr) {
+        return CatchEvent([&st, on_edit](Event e) {
             if (e.is_character() || e == Event::Backspace || e == Event::Delete) {
                 std::lock_guard<std::mutex> lock(st.mtx);
                 st.result_stale = true;
-                if (cache_value.has_value())
-                    cache_value->get() = false; // Помечаем кэш недействительным
+                if (on_edit) on_edit();
             }
             return false; // Пропускаем другие события дальше
         });
     };
 
-    auto input_a_tracked   = input_a   | mark_stale(st.cache_a_valid);
-    auto input_b_tracked   = input_b   | mark_stale(st.cache_b_valid);
+    // Помечаем кэш недействительным, но сам кэш не выбрасываем: если ещё не
+    // известно, из каких цифр он получен, запоминаем их, пока правка не применена
+    auto invalidate_cache = [&st](int which) {
+        return [&st, which] {
+            OperandRef op = operand_ref(st, which);
+            if (op.cache_valid && op.cached_digits.empty())
+                op.cached_digits = digits_only(op.input);
+            op.cache_valid = false;
+            bump_version(st, op);
+            st.last_edit = Clock::now(); // фоновый разбор ждёт паузы во вводе
+        };
+    };
+
+    auto input_a_tracked   = input_a   | mark_stale(invalidate_cache(0));
+    auto input_b_tracked   = input_b   | mark_stale(invalidate_cache(1));
     auto input_exp_tracked = input_exp | mark_stale();
+    auto input_expr_tracked = input_expr | mark_stale();
 
     // Выпадающий список операций
     int prev_selected_op = st.selected_op;
@@ -512,16 +965,32 @@ static void run_ui() {
 
     enum class GenKind { A, B, AB };
 
+    // Пути указывают на один файл (с точностью до "./", ".." и символических ссылок)
+    auto same_file = [](const std::string &a, const std::string &b) {
+        std::error_code ec_a, ec_b;
+        auto ca = std::filesystem::weakly_canonical(std::filesystem::absolute(a, ec_a), ec_a);
+        auto cb = std::filesystem::weakly_canonical(std::filesystem::absolute(b, ec_b), ec_b);
+        return (ec_a || ec_b) ? a == b : ca == cb;
+    };
+
     auto start_generate = [&](GenKind kind) {
         unsigned int gb = 256;
         std::string file_a, file_b;
+        uint64_t base_seed = 0;
         {
             std::lock_guard<std::mutex> lock(st.mtx);
             if (st.is_working) return;
             try { gb = static_cast<unsigned int>(std::stoul(st.gen_bytes_str)); } catch (...) {}
             if (gb < 1) gb = 1;
+            // Пустое или некорректное зерно - случайное; какое взяли, покажем в статусе
+            try { base_seed = std::stoull(st.seed_str); } catch (...) { base_seed = random_seed(); }
             file_a = st.file_a;
             file_b = st.file_b;
+            // A и B пишутся одновременно: в один файл они записались бы вперемешку
+            if (kind == GenKind::AB && same_file(file_a, file_b)) {
+                st.status_msg = "Ошибка: A и B нельзя генерировать в один и тот же файл";
+                return;
+            }
             st.is_working   = true;
             st.status_msg   = "Выполняется...";
             st.spinner_idx  = 0;
@@ -529,25 +998,55 @@ static void run_ui() {
         }
         start_spinner();
 
-        std::thread([&st, &screen, gb, file_a, file_b, kind]() {
+        std::thread([&st, &screen, gb, file_a, file_b, kind, base_seed]() {
+            // A и B берут зёрна из разных потоков одного базового зерна,
+            // так что пара воспроизводима и числа не совпадают
+            // В .bin десятичной записи нет, и строить её здесь - лишняя полная
+            // конвертация до публикации числа; запись для поля сделает run_bg_parser
+            auto gen = [gb](const std::string &path, uint64_t seed) {
+                GeneratedNumber g;
+                g.text_pending = format_for_path(path) == NumFormat::Binary;
+                g.value = generate_and_save(path, gb, seed, g.text_pending ? nullptr : &g.text, 80);
+                return g;
+            };
             try {
+                // Генерация и запись файлов идут без блокировки состояния;
+                // при генерации обоих B считается в отдельном потоке параллельно с A
+                std::future<GeneratedNumber> fut_b;
+                if (kind == GenKind::AB)
+                    fut_b = std::async(std::launch::async, gen, file_b, derive_seed(base_seed, 1));
+                std::optional<GeneratedNumber> ga, gb_num;
+                if (kind == GenKind::A || kind == GenKind::AB)
+                    ga = gen(file_a, derive_seed(base_seed, 0));
+                if (kind == GenKind::AB)
+                    gb_num = fut_b.get();
+                else if (kind == GenKind::B)
+                    gb_num = gen(file_b, derive_seed(base_seed, 1));
+
+                // Публикуем готовые числа под блокировкой - это только перемещения
                 std::lock_guard<std::mutex> lock(st.mtx);
-                if (kind == GenKind::A || kind == GenKind::AB) {
-                    generate_and_save(file_a, gb);
-                    std::string la = load_from_file(file_a);
-                    st.input_a       = wrap_number(la);
-                    st.cache_a_valid = false;
+                if (ga) {
+                    st.input_a       = std::move(ga->text);
+                    st.cached_bn_a   = std::move(ga->value);
+                    st.cached_digits_a.clear();
+                    st.cache_a_valid = true;
+                    bump_version(st, operand_ref(st, 0));
+                    st.text_pending_a = ga->text_pending;
                 }
-                if (kind == GenKind::B || kind == GenKind::AB) {
-                    generate_and_save(file_b, gb);
-                    std::string lb = load_from_file(file_b);
-                    st.input_b       = wrap_number(lb);
-                    st.cache_b_valid = false;
+                if (gb_num) {
+                    st.input_b       = std::move(gb_num->text);
+                    st.cached_bn_b   = std::move(gb_num->value);
+                    st.cached_digits_b.clear();
+                    st.cache_b_valid = true;
+                    bump_version(st, operand_ref(st, 1));
+                    st.text_pending_b = gb_num->text_pending;
                 }
                 st.result_stale = true;
-                st.status_msg   = (kind == GenKind::AB)
+                st.status_msg   = ((kind == GenKind::AB)
                     ? "Оба числа сгенерированы"
-                    : (kind == GenKind::A ? "A сгенерировано" : "B сгенерировано");
+                    : (kind == GenKind::A ? "A сгенерировано" : "B сгенерировано"))
+                    + std::string(" (зерно ") + std::to_string(base_seed) + ")";
+                st.cv.notify_all(); // будим фоновый поток строить запись
             } catch (const std::exception &ex) {
                 std::lock_guard<std::mutex> lock(st.mtx);
                 st.status_msg = std::string("Ошибка генерации: ") + ex.what();
@@ -579,10 +1078,15 @@ static void run_ui() {
             path_a = st.file_a;
         }
         try {
-            std::string loaded = wrap_number(load_from_file(path_a));
+            // Число разбирается прямо при загрузке, так что кэш сразу актуален
+            std::string loaded;
+            BigNum      bn = load_bignum_from_file(path_a, &loaded, 80);
             std::lock_guard<std::mutex> lock(st.mtx);
-            st.input_a       = loaded;
-            st.cache_a_valid = false;
+            st.input_a       = std::move(loaded);
+            st.cached_bn_a   = std::move(bn);
+            st.cached_digits_a.clear();
+            st.cache_a_valid = true;
+            bump_version(st, operand_ref(st, 0));
             st.status_msg    = "A загружено из " + path_a;
             st.result_stale  = true;
         } catch (const std::exception &ex) {
@@ -600,10 +1104,15 @@ static void run_ui() {
             path_b = st.file_b;
         }
         try {
-            std::string loaded = wrap_number(load_from_file(path_b));
+            // Число разбирается прямо при загрузке, так что кэш сразу актуален
+            std::string loaded;
+            BigNum      bn = load_bignum_from_file(path_b, &loaded, 80);
             std::lock_guard<std::mutex> lock(st.mtx);
-            st.input_b       = loaded;
-            st.cache_b_valid = false;
+            st.input_b       = std::move(loaded);
+            st.cached_bn_b   = std::move(bn);
+            st.cached_digits_b.clear();
+            st.cache_b_valid = true;
+            bump_version(st, operand_ref(st, 1));
             st.status_msg    = "B загружено из " + path_b;
             st.result_stale  = true;
         } catch (const std::exception &ex) {
@@ -631,15 +1140,47 @@ static void run_ui() {
 
     auto btn_quit = Button("  Выход  ", screen.ExitLoopClosure(), SmallAnimatedButtonOption(Color::Red));
 
+    // Перенос результата в A или B без конвертации в текст и обратного разбора:
+    // число сразу идёт в кэш, а запись для поля ввода строится в фоне.
+    // У деления переносится частное
+    auto chain_result = [&](int which) {
+        std::lock_guard<std::mutex> lock(st.mtx);
+        if (st.is_working) return;
+        if (st.result_nums.empty()) {
+            st.status_msg = "Ошибка: нет числового результата";
+            return;
+        }
+        OperandRef op = operand_ref(st, which);
+        bump_version(st, op);
+        op.cached_bn      = st.result_nums[0];
+        op.cached_digits.clear();
+        op.cache_valid    = true;
+        op.input.clear();
+        op.text_pending   = true;
+        st.result_stale   = true;
+        st.status_msg     = std::string("Результат перенесён в ") + (which == 0 ? "A" : "B");
+        st.cv.notify_all(); // будим фоновый поток строить запись
+    };
+
+    auto btn_res_a = Button(" Результат -> A ", [&] { chain_result(0); }, SmallAnimatedButtonOption(Color::Magenta));
+    auto btn_res_b = Button(" Результат -> B ", [&] { chain_result(1); }, SmallAnimatedButtonOption(Color::Magenta));
+
     // Контейнер всех компонентов
     auto all = Container::Vertical({
         Container::Horizontal({input_fa, input_fb}),
-        Container::Horizontal({input_gb, input_out}),
+        Container::Horizontal({input_gb, input_sd, input_out}),
         Container::Horizontal({input_a_tracked, input_b_tracked}),
         Container::Horizontal({btn_gen_a, btn_restore_a, btn_gen_b, btn_restore_b, btn_gen_ab}),
-        Container::Horizontal({dropdown, target_radio, input_exp_tracked}, &st.selected_option_component),
-        Container::Horizontal({btn_execute, btn_quit}),
+        // Скрытые параметры операции не получают фокус (иначе до поля выражения не дойти стрелками)
+        Container::Horizontal({
+            dropdown,
+            Maybe(target_radio,       [&st] { return st.selected_op == 3 || st.selected_op == 4; }),
+            Maybe(input_exp_tracked,  [&st] { return st.selected_op == 3; }),
+            Maybe(input_expr_tracked, [&st] { return st.selected_op == 6; }),
+        }, &st.selected_option_component),
+        Container::Horizontal({btn_execute, btn_quit, btn_res_a, btn_res_b}),
         result_input,
+        prof_panel,
     });
 
     // Основной рендерер
@@ -653,12 +1194,16 @@ static void run_ui() {
         bool        is_working   = false;
         int         spinner_idx  = 0;
         std::string result_text;
-        std::string input_a_val;
-        std::string input_b_val;
-        bool        show_con;
-        int  con_ra, con_rb, con_rs;
-        bool con_ok;
+        size_t      result_digits = 0;
+        size_t      result_limbs  = 0;
+        int         result_root   = -1;
+        bool        text_pending_a, text_pending_b;
+        NumSize     size_a, size_b;
+        bool           show_con;
+        std::string    con_relation, con_error;
+        BigNumResidues con_expected, con_actual;
         double t_parse_a, t_parse_b, t_op, t_to_dec;
+        std::vector<ProfRow> prof;
         int selected_op_local;
         int target_ab_local;
         {
@@ -668,17 +1213,26 @@ static void run_ui() {
             is_working        = st.is_working;
             spinner_idx       = st.spinner_idx;
             result_text       = st.result_text;
-            input_a_val       = st.input_a;
-            input_b_val       = st.input_b;
+            result_digits     = st.result_digits;
+            result_limbs      = st.result_limbs;
+            result_root       = st.result_root;
+            text_pending_a    = st.text_pending_a;
+            text_pending_b    = st.text_pending_b;
+            // Разобранное число (в том числе перенесённый результат, у которого
+            // записи ещё нет) меряется точно, иначе - по цифрам в поле ввода
+            // Точный размер - из фонового потока; пока его нет, оценка по цифрам
+            size_a = st.size_version_a == st.version_a ? st.size_a : num_size_estimate(count_digits(st.input_a));
+            size_b = st.size_version_b == st.version_b ? st.size_b : num_size_estimate(count_digits(st.input_b));
             show_con          = st.show_con;
-            con_ra            = st.con_ra;
-            con_rb            = st.con_rb;
-            con_rs            = st.con_rs;
-            con_ok            = st.con_ok;
+            con_relation      = st.con_relation;
+            con_error         = st.con_error;
+            con_expected      = st.con_expected;
+            con_actual        = st.con_actual;
             t_parse_a         = st.t_parse_a;
             t_parse_b         = st.t_parse_b;
             t_op              = st.t_op;
             t_to_dec          = st.t_to_dec;
+            prof              = st.prof_rows;
             selected_op_local = st.selected_op;
             target_ab_local   = st.target_ab;
 
@@ -716,11 +1270,6 @@ static void run_ui() {
             stale_indicator = text(" - Нет результата") | color(Color::GrayDark);
         }
 
-        // Количество цифр для подписей
-        size_t digits_a   = count_digits(input_a_val);
-        size_t digits_b   = count_digits(input_b_val);
-        size_t digits_res = count_digits(result_text);
-
         auto params_row = vbox({
             hbox({
                 text("Файл A: ") | color(Color::GrayLight),
@@ -731,24 +1280,27 @@ static void run_ui() {
             hbox({
                 text("Кол-во байт для генерации: ") | color(Color::GrayLight),
                 input_gb->Render() | size(WIDTH, EQUAL, 8) | notflex,
+                text("  Зерно: ") | color(Color::GrayLight),
+                input_sd->Render() | size(WIDTH, EQUAL, 21) | notflex,
                 text("  Файл результата: ") | color(Color::GrayLight),
                 input_out->Render() | flex,
                 })
             }) | border | notflex;
 
         // Блоки чисел A и B
-        auto num_box = [](const std::string &label, size_t digits, Component inp) {
+        auto num_box = [](const std::string &label, const NumSize &sz, bool pending, Component inp) {
             return window(
-                text(" " + label + " (" + std::to_string(digits) + " цифр) "),
+                text(" " + label + " (" + fmt_num_size(sz)
+                     + (pending ? ", запись строится..." : "") + ") "),
                 inp->Render() | vscroll_indicator | hscroll_indicator | frame |
                 size(HEIGHT, LESS_THAN, 10)
             ) | flex;
         };
 
         auto numbers_row = hbox({
-            num_box("Число A", digits_a, input_a_tracked),
+            num_box("Число A", size_a, text_pending_a, input_a_tracked),
             text("  "),
-            num_box("Число B", digits_b, input_b_tracked),
+            num_box("Число B", size_b, text_pending_b, input_b_tracked),
         }) | flex;
 
         // Кнопки генерации и загрузки
@@ -767,6 +1319,7 @@ static void run_ui() {
         // Блок выбора операции
         bool show_target = (selected_op_local == 3 || selected_op_local == 4);
         bool show_exp    = (selected_op_local == 3);
+        bool show_expr   = (selected_op_local == 6);
 
         Elements op_elems;
         op_elems.push_back(vbox({
@@ -779,8 +1332,8 @@ static void run_ui() {
                 text("Применить к:") | bold,
                 target_radio->Render(),
             }));
-        } else {
-            st.selected_option_component = std::min(st.selected_option_component, 0);
+        } else if (st.selected_option_component == 1) {
+            st.selected_option_component = 0;
         }
         op_elems.push_back(text("   "));
         if (show_exp) {
@@ -788,8 +1341,16 @@ static void run_ui() {
                 text("Степень (1-3):") | bold,
                 input_exp_tracked->Render() | size(WIDTH, EQUAL, 10),
             }));
-        } else {
-            st.selected_option_component = std::min(st.selected_option_component, 1);
+        } else if (st.selected_option_component == 2) {
+            st.selected_option_component = show_target ? 1 : 0;
+        }
+        if (show_expr) {
+            op_elems.push_back(vbox({
+                text("Выражение (A, B, числа, + - * / mod ^, скобки):") | bold,
+                input_expr_tracked->Render() | size(WIDTH, EQUAL, 50),
+            }));
+        } else if (st.selected_option_component == 3) {
+            st.selected_option_component = 0;
         }
         Element op_controls = hbox(op_elems) | notflex;
 
@@ -798,50 +1359,81 @@ static void run_ui() {
             btn_execute->Render(),
             text("  "),
             btn_quit->Render(),
+            text("    "),
+            btn_res_a->Render(),
+            text(" "),
+            btn_res_b->Render(),
             text("  "),
             stale_indicator,
         }) | notflex;
 
         // Результат
         auto result_box = window(
-            text(" Результат (" + std::to_string(digits_res) + " цифр) "),
+            text(" Результат ("
+                 + (result_limbs > 0 ? fmt_num_size({result_digits, result_limbs, true})
+                                     : std::to_string(result_digits) + " цифр")
+                 + (result_root >= 0 ? ", цифровой корень " + std::to_string(result_root) : "")
+                 + ") "),
             result_input->Render() | flex | vscroll_indicator | hscroll_indicator | frame
         ) | size(HEIGHT, LESS_THAN, 14) | flex;
 
-        // Блок исключения девяток (добавляется в отображение только при сложении)
+        // Блок проверки по остаткам (только для операций, у которых она есть)
         Element con_block = text("");
         if (show_con) {
-            auto mk_row = [](const std::string &lbl, int val) {
+            // Строка на модуль: что ожидалось по операндам и что у результата
+            auto mk_row = [](const std::string &lbl, uint64_t expected, uint64_t actual) {
                 return hbox({
                     text(lbl) | color(Color::GrayLight),
-                    text(std::to_string(val)) | bold,
+                    text(std::to_string(expected)) | bold,
+                    text(expected == actual ? " = " : " != ") | color(Color::GrayLight),
+                    text(std::to_string(actual)) | bold,
                 });
             };
-            // Формируем строку проверки
-            Color ck_color;
-            std::string check_lbl;
-            if (con_ok) {
-                ck_color = Color::Green;
-                check_lbl = " -> " + std::to_string(con_ra) + " + "
-                          + std::to_string(con_rb) + " = "
-                          + std::to_string(con_rs) + " (mod 9)  OK";
-            } else {
-                ck_color = Color::Red;
-                check_lbl = " -> ОШИБКА: " + std::to_string(con_ra) + " + "
-                          + std::to_string(con_rb) + " != "
-                          + std::to_string(con_rs) + " (mod 9)  FAIL";
-            }
+            bool con_ok = con_error.empty() && con_expected == con_actual;
+            std::string check_lbl = con_ok
+                ? " -> " + con_relation + ": сходится по всем модулям  OK"
+                : " -> ОШИБКА: " + (con_error.empty() ? con_relation + ": не сходится" : con_error) + "  FAIL";
 
-            con_block = window(text(" Проверка (исключение девяток) "),
+            con_block = window(text(" Проверка (остатки по модулям: по операндам = у результата) "),
                 vbox({
-                    mk_row("ЦС(A) mod 9 = ", con_ra),
-                    mk_row("ЦС(B) mod 9 = ", con_rb),
-                    mk_row("ЦС(сумма) mod 9 = ", con_rs),
-                    text(check_lbl) | color(ck_color) | bold,
+                    mk_row("mod 9:       ", con_expected.m9,  con_actual.m9),
+                    mk_row("mod 2^61-1:  ", con_expected.m61, con_actual.m61),
+                    mk_row("mod 2^64-59: ", con_expected.m64, con_actual.m64),
+                    text(check_lbl) | color(con_ok ? Color::Green : Color::Red) | bold,
                 })
             );
         }
 
+        // Профиль: самые долгие ядра (время включает вложенные вызовы,
+        // память - только выделенная в самом ядре)
+        {
+            constexpr size_t PROF_TOP_ROWS = 12;
+            std::sort(prof.begin(), prof.end(), [](const ProfRow &a, const ProfRow &b) { return a.ns > b.ns; });
+            auto cell = [](std::string s, int width) {
+                return text(std::move(s)) | size(WIDTH, EQUAL, width);
+            };
+            Elements rows;
+            rows.push_back(hbox({
+                cell("ядро", 14), cell("уровень", 9), cell("вызовов", 11), cell("время", 16), cell("память", 12),
+            }) | color(Color::GrayLight));
+            for (size_t i = 0; i < prof.size() && i < PROF_TOP_ROWS; ++i) {
+                const ProfRow &r = prof[i];
+                rows.push_back(hbox({
+                    cell(prof_kernel_name(r.kernel), 14) | bold,
+                    cell(std::to_string(r.level), 9),
+                    cell(std::to_string(r.calls), 11),
+                    cell(fmt_ms(r.ns / 1e6), 16),
+                    cell(fmt_bytes(r.bytes), 12),
+                }));
+            }
+            if (prof.size() > PROF_TOP_ROWS)
+                rows.push_back(text("... ещё строк: " + std::to_string(prof.size() - PROF_TOP_ROWS)
+                                    + " (все - bignums --op ... --profile FILE)") | color(Color::GrayDark));
+            if (prof.empty())
+                rows.push_back(text("(нет данных - выполните операцию при открытой панели)") | color(Color::GrayDark));
+            prof_table = vbox(std::move(rows));
+        }
+
         // Тайминги
         Element timings = hbox({
             timing_row("Парсинг A", t_parse_a),
@@ -883,17 +1475,34 @@ static void run_ui() {
             main_elems.push_back(con_block);
         }
 
+        main_elems.push_back(prof_panel->Render() | border | notflex);
         main_elems.push_back(timings);
         main_elems.push_back(status_bar);
         
         return vbox(std::move(main_elems));
     });
 
+    std::thread bg_parser([&st, &screen] {
+        run_bg_parser(st, [&screen] { screen.PostEvent(Event::Custom); });
+    });
+
     screen.Loop(renderer);
+
+    {
+        std::lock_guard<std::mutex> lock(st.mtx);
+        st.quitting  = true;
+        st.bg_cancel = true;
+    }
+    st.cv.notify_all();
+    bg_parser.join();
 }
 
 // -----------------------------------------------------------------------
-int main() {
+int main(int argc, char **argv) {
+    // С параметрами - режим командной строки без интерфейса (см. cli.hpp).
+    // Один --huge-pages - интерфейс с большими страницами
+    if (argc == 2 && std::string_view(argv[1]) == "--huge-pages") bignum_set_huge_pages(true);
+    else if (argc > 1) return run_cli(argc, argv);
     run_ui();
     return 0;
 }
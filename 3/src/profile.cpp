@@ -0,0 +1,252 @@
+#include "profile.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+
+namespace prof_detail {
+std::atomic<bool> enabled{false};
+}
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr size_t KERNELS = static_cast<size_t>(ProfKernel::Count);
+
+const char *const KERNEL_NAMES[KERNELS] = {
+    "from_decimal", "to_decimal", "pow10", "pad", "digits",
+    "add", "sub", "mul", "sqr", "divmod", "shift",
+    "isqrt", "gcd", "gcdext", "mod_small", "residues",
+};
+
+// ----------------------------------------------------------------------------
+// Таблица счётчиков потока. Пишет только сам поток, читает prof_rows из любого,
+// поэтому счётчики атомарные, но прибавление - обычные load и store без
+// блокирующих инструкций: писатель один, а читателю хватает любого из значений
+// ----------------------------------------------------------------------------
+
+struct Counter {
+    std::atomic<uint64_t> v{0};
+
+    void     add(uint64_t x) { v.store(v.load(std::memory_order_relaxed) + x, std::memory_order_relaxed); }
+    uint64_t get() const     { return v.load(std::memory_order_relaxed); }
+    void     reset()         { v.store(0, std::memory_order_relaxed); }
+};
+
+struct Entry {
+    Counter calls, ns, bytes;
+};
+
+struct ThreadTable {
+    Entry      entries[KERNELS][PROF_MAX_LEVEL];
+    unsigned   depth[KERNELS] = {}; // сколько вызовов каждого ядра сейчас на стеке
+    ProfScope *current        = nullptr;
+    unsigned   tid            = 0;
+
+    std::mutex             events_mtx;
+    std::vector<ProfEvent> events;
+};
+
+// Таблицы живых потоков и уже завершившихся (их счётчики нужны до следующего prof_start)
+struct Registry {
+    std::mutex                                mtx;
+    std::vector<ThreadTable *>                live;
+    std::vector<std::unique_ptr<ThreadTable>> retired;
+    unsigned                                  next_tid = 1;
+};
+
+Registry &registry() {
+    static Registry r;
+    return r;
+}
+
+std::atomic<bool>     g_trace{false};
+std::atomic<uint64_t> g_start_ns{0};
+
+uint64_t now_ns() {
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count());
+}
+
+struct TableHolder {
+    std::unique_ptr<ThreadTable> table;
+
+    ~TableHolder() {
+        if (!table) return;
+        Registry &r = registry();
+        std::lock_guard<std::mutex> lock(r.mtx);
+        r.live.erase(std::find(r.live.begin(), r.live.end(), table.get()));
+        r.retired.push_back(std::move(table));
+    }
+};
+
+ThreadTable &local_table() {
+    thread_local TableHolder holder;
+    if (!holder.table) {
+        holder.table = std::make_unique<ThreadTable>();
+        Registry &r  = registry();
+        std::lock_guard<std::mutex> lock(r.mtx);
+        holder.table->tid = r.next_tid++;
+        r.live.push_back(holder.table.get());
+    }
+    return *holder.table;
+}
+
+void reset_table(ThreadTable &t) {
+    for (auto &row : t.entries)
+        for (Entry &e : row) {
+            e.calls.reset();
+            e.ns.reset();
+            e.bytes.reset();
+        }
+    std::lock_guard<std::mutex> lock(t.events_mtx);
+    t.events.clear();
+}
+
+// Строка для JSON: имена ядер - только латиница и '_', экранировать нечего
+void append_fmt(std::string &out, const char *fmt, auto... args) {
+    char buf[256];
+    int  n = std::snprintf(buf, sizeof(buf), fmt, args...);
+    out.append(buf, static_cast<size_t>(std::max(n, 0)));
+}
+
+} // namespace
+
+const char *prof_kernel_name(ProfKernel k) {
+    return KERNEL_NAMES[static_cast<size_t>(k)];
+}
+
+// ----------------------------------------------------------------------------
+// Вход и выход из ProfScope
+// ----------------------------------------------------------------------------
+
+void prof_detail::enter(ProfScope &s, ProfKernel k) {
+    ThreadTable &t = local_table();
+    unsigned    &d = t.depth[static_cast<size_t>(k)];
+    s.active_ = true;
+    s.kernel_ = k;
+    s.level_  = std::min(d, PROF_MAX_LEVEL - 1);
+    ++d;
+    s.parent_ = t.current;
+    t.current = &s;
+    s.t0_     = now_ns();
+}
+
+void prof_detail::leave(ProfScope &s) {
+    uint64_t     end = now_ns();
+    ThreadTable &t   = local_table();
+    --t.depth[static_cast<size_t>(s.kernel_)];
+    t.current = s.parent_;
+
+    Entry &e = t.entries[static_cast<size_t>(s.kernel_)][s.level_];
+    e.calls.add(1);
+    e.ns.add(end - s.t0_);
+    e.bytes.add(s.bytes_);
+
+    if (g_trace.load(std::memory_order_relaxed)) {
+        std::lock_guard<std::mutex> lock(t.events_mtx);
+        if (t.events.size() < PROF_MAX_EVENTS) {
+            uint64_t start = g_start_ns.load(std::memory_order_relaxed);
+            t.events.push_back({s.kernel_, s.level_, t.tid, s.t0_ > start ? s.t0_ - start : 0, end - s.t0_});
+        }
+    }
+}
+
+void prof_detail::note_alloc(size_t bytes) {
+    ThreadTable &t = local_table();
+    if (t.current) t.current->bytes_ += bytes;
+}
+
+// ----------------------------------------------------------------------------
+// Управление и снимки
+// ----------------------------------------------------------------------------
+
+void prof_start(bool trace) {
+    Registry &r = registry();
+    {
+        std::lock_guard<std::mutex> lock(r.mtx);
+        for (ThreadTable *t : r.live) reset_table(*t);
+        r.retired.clear();
+    }
+    g_start_ns.store(now_ns(), std::memory_order_relaxed);
+    g_trace.store(trace, std::memory_order_relaxed);
+    prof_detail::enabled.store(true, std::memory_order_relaxed);
+}
+
+void prof_stop() {
+    prof_detail::enabled.store(false, std::memory_order_relaxed);
+}
+
+std::vector<ProfRow> prof_rows() {
+    uint64_t sum[KERNELS][PROF_MAX_LEVEL][3] = {};
+    auto add = [&sum](const ThreadTable &t) {
+        for (size_t k = 0; k < KERNELS; ++k)
+            for (unsigned l = 0; l < PROF_MAX_LEVEL; ++l) {
+                sum[k][l][0] += t.entries[k][l].calls.get();
+                sum[k][l][1] += t.entries[k][l].ns.get();
+                sum[k][l][2] += t.entries[k][l].bytes.get();
+            }
+    };
+    {
+        Registry &r = registry();
+        std::lock_guard<std::mutex> lock(r.mtx);
+        for (const ThreadTable *t : r.live) add(*t);
+        for (const auto &t : r.retired) add(*t);
+    }
+
+    std::vector<ProfRow> rows;
+    for (size_t k = 0; k < KERNELS; ++k)
+        for (unsigned l = 0; l < PROF_MAX_LEVEL; ++l)
+            if (sum[k][l][0] > 0)
+                rows.push_back({static_cast<ProfKernel>(k), l, sum[k][l][0], sum[k][l][1], sum[k][l][2]});
+    return rows;
+}
+
+std::vector<ProfEvent> prof_events() {
+    std::vector<ProfEvent> events;
+    auto add = [&events](ThreadTable &t) {
+        std::lock_guard<std::mutex> lock(t.events_mtx);
+        events.insert(events.end(), t.events.begin(), t.events.end());
+    };
+    {
+        Registry &r = registry();
+        std::lock_guard<std::mutex> lock(r.mtx);
+        for (ThreadTable *t : r.live) add(*t);
+        for (auto &t : r.retired) add(*t);
+    }
+    std::sort(events.begin(), events.end(),
+              [](const ProfEvent &a, const ProfEvent &b) { return a.start_ns < b.start_ns; });
+    return events;
+}
+
+std::string prof_json() {
+    std::string out = "{\"kernels\": [";
+    bool first = true;
+    for (const ProfRow &r : prof_rows()) {
+        append_fmt(out, "%s\n  {\"kernel\": \"%s\", \"level\": %u, \"calls\": %llu, \"ns\": %llu, \"bytes\": %llu}",
+                   first ? "" : ",", prof_kernel_name(r.kernel), r.level,
+                   static_cast<unsigned long long>(r.calls), static_cast<unsigned long long>(r.ns),
+                   static_cast<unsigned long long>(r.bytes));
+        first = false;
+    }
+    out += "\n]}\n";
+    return out;
+}
+
+std::string prof_chrome_trace() {
+    // Время в трассе - в микросекундах, дробное
+    std::string out = "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [";
+    bool first = true;
+    for (const ProfEvent &e : prof_events()) {
+        append_fmt(out, "%s\n  {\"name\": \"%s\", \"cat\": \"bignum\", \"ph\": \"X\", \"pid\": 1, \"tid\": %u, "
+                        "\"ts\": %.3f, \"dur\": %.3f, \"args\": {\"level\": %u}}",
+                   first ? "" : ",", prof_kernel_name(e.kernel), e.tid,
+                   static_cast<double>(e.start_ns) / 1000.0, static_cast<double>(e.dur_ns) / 1000.0, e.level);
+        first = false;
+    }
+    out += "\n]}\n";
+    return out;
+}
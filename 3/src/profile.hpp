@@ -0,0 +1,91 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Профилировщик горячих мест bignum.cpp: ProfScope в начале функции считает
+// вызовы, время (включая вложенные вызовы) и байты, выделенные BigNum прямо в
+// ней (без вложенных ProfScope). Уровень - глубина рекурсии того же ядра
+// (у to_decimal это уровень разбиения пополам). Пока профиль выключен,
+// ProfScope - одна проверка флага, LimbAllocator - тоже.
+// Счётчики у каждого потока свои, prof_rows складывает их
+
+enum class ProfKernel : uint8_t {
+    FromDecimal, ToDecimal, Pow10, Pad, Digits,
+    Add, Sub, Mul, Sqr, Divmod, Shift,
+    Isqrt, Gcd, GcdExt, ModSmall, Residues,
+    Count
+};
+
+// Глубже - в последний уровень
+inline constexpr unsigned PROF_MAX_LEVEL = 32;
+
+const char *prof_kernel_name(ProfKernel k);
+
+struct ProfRow {
+    ProfKernel kernel;
+    unsigned   level;
+    uint64_t   calls, ns, bytes;
+};
+
+// Событие для трассы: отрезок [start_ns, start_ns + dur_ns) от prof_start
+struct ProfEvent {
+    ProfKernel kernel;
+    unsigned   level;
+    unsigned   tid;
+    uint64_t   start_ns, dur_ns;
+};
+
+// Сбрасывает накопленное и включает сбор; trace - ещё и события по каждому вызову
+// (до PROF_MAX_EVENTS на поток, дальше только счётчики)
+inline constexpr size_t PROF_MAX_EVENTS = 1u << 20;
+void prof_start(bool trace = false);
+void prof_stop();
+
+std::vector<ProfRow>   prof_rows();   // ненулевые, по ядру и уровню
+std::vector<ProfEvent> prof_events(); // по времени начала
+
+// {"kernels": [{"kernel", "level", "calls", "ns", "bytes"}, ...]}
+std::string prof_json();
+// Формат Chrome trace (chrome://tracing, Perfetto): события "X" по потокам
+std::string prof_chrome_trace();
+
+class ProfScope;
+
+namespace prof_detail {
+extern std::atomic<bool> enabled;
+void enter(ProfScope &s, ProfKernel k);
+void leave(ProfScope &s);
+void note_alloc(size_t bytes);
+}
+
+class ProfScope {
+public:
+    explicit ProfScope(ProfKernel k) {
+        if (prof_detail::enabled.load(std::memory_order_relaxed)) prof_detail::enter(*this, k);
+    }
+    ~ProfScope() {
+        if (active_) prof_detail::leave(*this);
+    }
+    ProfScope(const ProfScope &) = delete;
+    ProfScope &operator=(const ProfScope &) = delete;
+
+private:
+    friend void prof_detail::enter(ProfScope &, ProfKernel);
+    friend void prof_detail::leave(ProfScope &);
+    friend void prof_detail::note_alloc(size_t);
+
+    bool       active_ = false;
+    ProfKernel kernel_{};
+    unsigned   level_  = 0;
+    uint64_t   t0_     = 0;
+    uint64_t   bytes_  = 0;
+    ProfScope *parent_ = nullptr;
+};
+
+// Вызывается из LimbAllocator на каждое выделение
+inline void prof_note_alloc(size_t bytes) {
+    if (prof_detail::enabled.load(std::memory_order_relaxed)) prof_detail::note_alloc(bytes);
+}